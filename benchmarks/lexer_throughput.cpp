@@ -0,0 +1,119 @@
+// lexer_throughput.cpp - Measures raw lexer speed in MB/s
+//
+// Usage: lexer_throughput [script.del ...]
+// Without arguments a synthetic source mixing identifiers, numbers,
+// strings, comments and indentation is generated. Every input is
+// tokenized to TOKEN_EOF repeatedly, both token by token with scanToken()
+// and in one go with tokenizeSource(), and the best pass of each is reported.
+
+#include <chrono>   // For steady_clock
+#include <cstdio>   // For printf
+#include <fstream>  // For reading input files
+#include <iterator> // For istreambuf_iterator
+#include <string>   // For std::string
+
+#include "lexer.h" // Lexer under test
+
+// Minimum amount of text lexed per input, to smooth out timer noise
+#define TARGET_BYTES (64u * 1024 * 1024)
+
+/**
+ * Builds a synthetic script of roughly `size` bytes.
+ */
+static std::string syntheticSource(size_t size)
+{
+    std::string source;
+    for (int i = 0; source.size() < size; i++) {
+        source += "// Comment line number " + std::to_string(i) + " with some prose\n";
+        source += "fun function_" + std::to_string(i) + "(alpha, beta) {\n";
+        source += "    var total_value = alpha * 3.25 + beta - " + std::to_string(i) + ";\n";
+        source += "    if (total_value >= 100) { println \"large value, keep going\"; }\n";
+        source += "    return total_value;\n";
+        source += "}\n\n";
+    }
+    return source;
+}
+
+/**
+ * Lexes `source` with scanToken() until TOKEN_EOF.
+ *
+ * @return Number of tokens, including TOKEN_EOF
+ */
+static long scanAll(std::string const& source)
+{
+    initLexer(source.data(), source.size());
+    long count = 0;
+    for (;;) {
+        Token token = scanToken();
+        count++;
+        if (token.type == TOKEN_EOF)
+            return count;
+    }
+}
+
+/**
+ * Lexes `source` into a token stream.
+ *
+ * @return Number of tokens, including TOKEN_EOF
+ */
+static long streamAll(std::string const& source)
+{
+    TokenStream stream;
+    tokenizeSource(&stream, source.data(), source.size());
+    long count = stream.count;
+    freeTokenStream(&stream);
+    return count;
+}
+
+/**
+ * Runs `lex` on `source` enough times to cover TARGET_BYTES and prints
+ * the throughput of the fastest pass.
+ */
+static void measure(char const* name, char const* mode, std::string const& source,
+    long (*lex)(std::string const&))
+{
+    int passes = (int)(TARGET_BYTES / source.size()) + 1;
+    double best = 0;
+    long tokens = 0;
+
+    for (int pass = 0; pass < passes; pass++) {
+        auto start = std::chrono::steady_clock::now();
+        tokens = lex(source);
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        if (pass == 0 || seconds < best)
+            best = seconds;
+    }
+
+    printf("%-28s %-7s %10zu bytes %9ld tokens %9.1f MB/s\n", name, mode,
+        source.size(), tokens, source.size() / best / (1024.0 * 1024.0));
+}
+
+/**
+ * Measures both lexing modes on one input.
+ */
+static void measureBoth(char const* name, std::string const& source)
+{
+    measure(name, "scan", source, scanAll);
+    measure(name, "stream", source, streamAll);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        measureBoth("synthetic", syntheticSource(4u * 1024 * 1024));
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            fprintf(stderr, "Could not open file: %s\n", argv[i]);
+            return 74;
+        }
+        std::string source((std::istreambuf_iterator<char>(file)),
+            std::istreambuf_iterator<char>());
+        measureBoth(argv[i], source);
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "common.h" // For size_t
+
+// ======================
+// Arena Allocator
+// ======================
+
+/**
+ * Header of one arena block; the usable bytes follow it.
+ */
+typedef struct ArenaBlock {
+    struct ArenaBlock* next; // Previously filled block
+    size_t size;             // Usable bytes in this block
+    size_t used;             // Bytes handed out so far
+} ArenaBlock;
+
+/**
+ * Bump allocator for short-lived data that is released all at once.
+ *
+ * Used by the compiler for Compiler records and for chunk arrays while
+ * they are still growing. Nothing is freed individually; freeArena()
+ * drops every block in one go.
+ */
+typedef struct Arena {
+    ArenaBlock* head; // Block currently being filled
+    void* last;       // Most recent allocation (can be grown in place)
+} Arena;
+
+/**
+ * Allocates `count` elements of `type` from an arena.
+ */
+#define ARENA_ALLOCATE(arena, type, count) \
+    (type*)arenaAllocate(arena, sizeof(type) * (count))
+
+/**
+ * Grows an array previously allocated from the same arena.
+ */
+#define ARENA_GROW_ARRAY(arena, type, pointer, oldCount, newCount) \
+    (type*)arenaGrow(arena, pointer, sizeof(type) * (oldCount),    \
+        sizeof(type) * (newCount))
+
+/**
+ * Initializes an empty arena.
+ *
+ * @param arena Arena to prepare
+ */
+void initArena(Arena* arena);
+
+/**
+ * Allocates uninitialized memory from an arena.
+ *
+ * @param arena Arena to allocate from
+ * @param size Number of bytes (rounded up to 16-byte alignment)
+ * @return Pointer to the new memory
+ */
+void* arenaAllocate(Arena* arena, size_t size);
+
+/**
+ * Resizes an arena allocation.
+ *
+ * @param arena Arena the block came from
+ * @param pointer Existing allocation (or NULL)
+ * @param oldSize Current size in bytes
+ * @param newSize Desired size in bytes
+ * @return Pointer to the resized memory
+ *
+ * @note The most recent allocation grows in place when the block has room;
+ *       otherwise the data is copied and the old space is abandoned
+ */
+void* arenaGrow(Arena* arena, void* pointer, size_t oldSize, size_t newSize);
+
+/**
+ * Releases every block of an arena at once.
+ *
+ * @param arena Arena to release (left empty and reusable)
+ */
+void freeArena(Arena* arena);
+
+#endif // ARENA_H
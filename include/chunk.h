@@ -4,6 +4,9 @@
 #include "common.h" // Common definitions and utilities
 #include "value.h"  // Value type definitions
 
+/* Compile-time arena (defined in arena.h) */
+typedef struct Arena Arena;
+
 // ======================
 // Bytecode Instruction Set
 // ======================
@@ -16,7 +19,8 @@
  */
 typedef enum OpCode {
     // Constants and literals
-    OP_CONSTANT, // Loads constant from constant pool
+    OP_CONSTANT,      // Loads constant from constant pool
+    OP_CONSTANT_LONG, // Loads constant with a 24-bit pool index
     OP_NIL,      // Pushes nil value
     OP_TRUE,     // Pushes true value
     OP_FALSE,    // Pushes false value
@@ -29,6 +33,11 @@ typedef enum OpCode {
     OP_DEFINE_GLOBAL, // Defines new global variable
     OP_SET_GLOBAL,    // Sets existing global variable
 
+    // Global variable operations with a 24-bit name index
+    OP_GET_GLOBAL_LONG,
+    OP_DEFINE_GLOBAL_LONG,
+    OP_SET_GLOBAL_LONG,
+
     // Comparisons
     OP_EQUAL,   // Equality comparison (==)
     OP_GREATER, // Greater-than comparison (>)
@@ -41,6 +50,7 @@ typedef enum OpCode {
     OP_DIVIDE,   // Division (/)
     OP_MODULO,   // Modulo (%)
     OP_NEGATE,   // Unary negation (-)
+    OP_CONCAT_N, // Concatenates the top N stack values (N in next byte)
 
     // Logical operations
     OP_NOT, // Logical NOT (!)
@@ -51,14 +61,69 @@ typedef enum OpCode {
     OP_JUMP,          // Unconditional jump
     OP_JUMP_IF_FALSE, // Conditional jump (if false)
     OP_LOOP,          // Jump backward (for loops)
+    OP_FOR_STEP,      // Counted-loop step: increment, compare, jump backward
     OP_CALL,          // Calls function
     OP_RETURN,        // Returns from function
+    OP_IMPORT,        // Runs the module on the stack unless it already ran
 } OpCode;
 
+// ======================
+// Counted Loop Operands
+// ======================
+
+/**
+ * Mode byte of an OP_FOR_STEP instruction.
+ *
+ * The low two bits select the comparison applied between the induction
+ * variable and the loop limit; the remaining bits select where the limit
+ * operand is read from. Build it with FOR_STEP_MODE().
+ *
+ * Layout of the full instruction:
+ *   OP_FOR_STEP slot step mode limit offsetHi offsetLo
+ */
+typedef enum ForStepCompare {
+    FOR_CMP_LESS,        // counter <  limit
+    FOR_CMP_GREATER,     // counter >  limit
+    FOR_CMP_NOT_LESS,    // !(counter < limit), i.e. >=
+    FOR_CMP_NOT_GREATER, // !(counter > limit), i.e. <=
+} ForStepCompare;
+
+typedef enum ForStepLimit {
+    FOR_LIMIT_LOCAL,    // Limit is a local variable slot
+    FOR_LIMIT_CONSTANT, // Limit is a constant pool index
+    FOR_LIMIT_GLOBAL,   // Limit is a global, named by a constant pool index
+} ForStepLimit;
+
+/** Packs a comparison and a limit source into an OP_FOR_STEP mode byte */
+#define FOR_STEP_MODE(compare, limit) ((uint8_t)(((limit) << 2) | (compare)))
+
+/** Extracts the ForStepCompare from an OP_FOR_STEP mode byte */
+#define FOR_STEP_COMPARE(mode) ((ForStepCompare)((mode) & 0x3))
+
+/** Extracts the ForStepLimit from an OP_FOR_STEP mode byte */
+#define FOR_STEP_LIMIT(mode) ((ForStepLimit)((mode) >> 2))
+
+/**
+ * Largest constant pool index addressable by the *_LONG opcodes,
+ * whose operand is a 24-bit big-endian index.
+ */
+#define CONSTANT_LONG_MAX 0xffffff
+
 // ======================
 // Bytecode Chunk Structure
 // ======================
 
+/**
+ * Start of a run of bytecode bytes that share one source line.
+ *
+ * Line information is run-length encoded: each entry covers the bytes
+ * from its offset up to the next entry's offset.
+ */
+typedef struct LineStart {
+    int offset; // First bytecode offset of the run
+    int line;   // Source line of every byte in the run
+} LineStart;
+
 /**
  * Represents a sequence of bytecode instructions and associated data.
  *
@@ -70,7 +135,13 @@ typedef struct Chunk {
     int capacity;         // Total allocated size of code array
     uint8_t* code;        // Dynamic array of bytecode instructions
     ValueArray constants; // Constant pool (literals, strings, etc)
-    int* lines;           // Source line numbers for each instruction (debugging)
+    int lineCount;        // Number of runs in lines
+    int lineCapacity;     // Allocated size of lines array
+    LineStart* lines;     // Run-length encoded source lines (debugging)
+    int* constantIndex;   // Open-addressing index into constants (-1 = empty)
+    int indexCapacity;    // Slots in constantIndex (power of two)
+    bool sealed;          // Code was moved to the read-only code heap
+    Arena* arena;         // Arena holding the growing arrays (NULL once sealed)
 } Chunk;
 
 // ======================
@@ -93,6 +164,33 @@ void initChunk(Chunk* chunk);
  */
 void writeChunk(Chunk* chunk, uint8_t byte, int line);
 
+/**
+ * Moves a finished chunk's bytecode into the code heap and its line
+ * table and constants into exactly sized heap arrays.
+ *
+ * @param chunk Chunk that will not be written to again
+ *
+ * @note The growable buffers and the constant dedup index are dropped
+ */
+void sealChunk(Chunk* chunk);
+
+/**
+ * Discards bytecode past the given offset, along with its line runs.
+ *
+ * @param chunk Target chunk
+ * @param count New byte count (must not exceed the current count)
+ */
+void truncateChunk(Chunk* chunk, int count);
+
+/**
+ * Looks up the source line of a bytecode offset.
+ *
+ * @param chunk Chunk containing the instruction
+ * @param offset Byte offset within the chunk's code array
+ * @return Source line number (binary search over the line runs)
+ */
+int getLine(Chunk* chunk, int offset);
+
 /**
  * Releases all memory owned by a chunk.
  *
@@ -106,6 +204,8 @@ void freeChunk(Chunk* chunk);
  * @param chunk Target chunk
  * @param value Value to add (number, string, etc)
  * @return Index of the constant in the pool
+ *
+ * @note Identical values (same bits, or same object) share one index
  */
 int addConstant(Chunk* chunk, Value value);
 
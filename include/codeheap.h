@@ -0,0 +1,45 @@
+#ifndef CODEHEAP_H
+#define CODEHEAP_H
+
+#include "common.h" // For size_t and fixed-width integer types
+
+// ======================
+// Code Heap
+// ======================
+
+/**
+ * The code heap is a contiguous arena that holds the bytecode of every
+ * finished chunk. Compiled functions are packed back to back (inner
+ * functions right before the functions that call them) with no growth
+ * slack, and the arena is mapped read-only between compilations so the
+ * dispatch loop cannot be corrupted by stray writes.
+ */
+
+/**
+ * Copies finished bytecode into the code heap.
+ *
+ * @param code  Bytecode to copy
+ * @param count Number of bytes
+ * @return Address of the copy inside the code heap
+ *
+ * @note Makes the destination block writable again if it was sealed
+ * @note Safe to call from several threads at once; sealCodeHeap() and
+ *       freeCodeHeap() are not
+ */
+uint8_t* codeHeapStore(uint8_t const* code, int count);
+
+/**
+ * Maps every code heap block read-only.
+ *
+ * @note Called once a compilation finishes
+ */
+void sealCodeHeap();
+
+/**
+ * Releases all code heap blocks.
+ *
+ * @note Called during VM shutdown; chunks pointing into the heap become invalid
+ */
+void freeCodeHeap();
+
+#endif // CODEHEAP_H
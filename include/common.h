@@ -33,6 +33,69 @@
  */
 #define DEBUG_MUTATE_CODE
 
+// ======================
+// Compiler Configuration
+// ======================
+
+/**
+ * @def LAZY_COMPILE
+ * When defined, the compiler only scans over function bodies, recording
+ * their source span and arity in a stub ObjFunction. A body is compiled the
+ * first time the function is called, so syntax errors inside functions that
+ * never run go unreported.
+ */
+// #define LAZY_COMPILE
+
+/**
+ * @def TOKEN_STREAM
+ * When defined, compile() lexes the whole script into a TokenStream
+ * (parallel arrays of types, offsets and lengths plus a line index)
+ * before parsing, instead of pulling tokens from scanToken() one at a
+ * time. The stream allows arbitrary lookahead and separates lexing from
+ * parsing for profiling, but writing and re-reading the token arrays
+ * currently makes compiling large scripts slightly slower, so it is off
+ * by default.
+ */
+// #define TOKEN_STREAM
+
+// ======================
+// Memory Configuration
+// ======================
+
+/**
+ * @def POOL_ALLOCATOR
+ * When defined, reallocate() serves small blocks (up to 256 bytes) from
+ * per-size-class free lists carved out of slab pages. Larger blocks still
+ * go to the system allocator. Comment out to compare against plain malloc.
+ */
+#define POOL_ALLOCATOR
+
+/**
+ * @def STRING_HASH_WYHASH
+ * Selects the string hash function. The default is a wyhash-style hash
+ * that consumes 8 bytes per step; defining STRING_HASH_FNV1A instead
+ * (e.g. -DSTRING_HASH_FNV1A) restores the byte-at-a-time FNV-1a hash.
+ */
+#if !defined(STRING_HASH_FNV1A) && !defined(STRING_HASH_WYHASH)
+#define STRING_HASH_WYHASH
+#endif
+
+/**
+ * @def NUMBER_FORMAT_GENERAL
+ * When defined, numbers print exactly as printf's "%g" would (six
+ * significant digits). By default they print in the shortest form that
+ * reads back as the same double, e.g. 0.1 + 0.2 prints
+ * 0.30000000000000004 rather than 0.3.
+ */
+// #define NUMBER_FORMAT_GENERAL
+
+/**
+ * @def DEBUG_MEMORY_STATS
+ * When defined, prints per-size-class allocation statistics to stderr
+ * when the VM shuts down.
+ */
+// #define DEBUG_MEMORY_STATS
+
 // ======================
 // VM Constants
 // ======================
@@ -7,13 +7,53 @@
 /**
  * Compiles Delirium source code into executable bytecode.
  *
- * @param source Null-terminated string containing Delirium source code
+ * @param source Delirium source code (need not be null-terminated)
+ * @param length Length of the source in bytes
  * @return Pointer to compiled ObjFunction containing the bytecode,
  *         or NULL if compilation fails
  *
  * @note The returned ObjFunction owns all generated bytecode and constants.
  * @note Errors during compilation are reported via stderr output.
  */
-ObjFunction* compile(char const* source);
+ObjFunction* compile(char const* source, size_t length);
+
+/**
+ * Compiles the body of a function stub created in LAZY_COMPILE mode.
+ *
+ * @param function Stub whose body span has not been compiled yet
+ * @return true on success, false if the body has compile errors
+ *
+ * @note The source the stub was scanned from must still be alive.
+ */
+bool compileFunction(ObjFunction* function);
+
+/**
+ * Counts of the top-level functions in the last compile().
+ */
+typedef struct RecompileStats {
+    int reused;   // Taken unchanged from the previous compile
+    int compiled; // Compiled from source
+} RecompileStats;
+
+/**
+ * Makes compile() keep the top-level functions of the main script and
+ * reuse them in the next compile when their source is unchanged.
+ *
+ * Functions are keyed by a hash of their name and body span. A function
+ * is reused when a declaration with the same name and the same body text
+ * follows the same imports in the new source; its body is then neither
+ * lexed nor compiled, and only its line numbers are shifted.
+ *
+ * @note Meant for a process that recompiles one script repeatedly
+ *       (--watch); replaced functions are kept until the VM is freed.
+ */
+void enableFunctionCache();
+
+/**
+ * Reports how the last compile() obtained its top-level functions.
+ *
+ * @return Reused and compiled counts (both zero unless the cache is on)
+ */
+RecompileStats functionCacheStats();
 
 #endif // COMPILER_H
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "common.h" // For basic type definitions
+#include "value.h"  // For ObjString forward declaration
+
+// ======================
+// String Intern Set
+// ======================
+
+/**
+ * Set of interned strings, keyed by content.
+ *
+ * A key-only open-addressing table: each slot holds an ObjString* and,
+ * in a parallel array, that string's full hash, so a probe compares
+ * hashes without touching the string until one matches. Collisions are
+ * resolved by linear probing over a power-of-two capacity, and removal
+ * shifts later entries back instead of leaving tombstones, so an empty
+ * slot always ends a probe.
+ *
+ * The set does not keep its strings alive; the VM object list owns them.
+ */
+typedef struct InternSet {
+    int count;            // Number of strings stored
+    int capacity;         // Number of slots (zero or a power of two)
+    uint32_t* hashes;     // Cached hash per slot
+    ObjString** strings;  // String per slot (NULL when empty)
+} InternSet;
+
+/**
+ * Initializes an empty intern set.
+ *
+ * @param set Uninitialized set to prepare for use
+ */
+void initInternSet(InternSet* set);
+
+/**
+ * Releases the set's slot arrays (not the strings themselves).
+ *
+ * @param set Set to deallocate
+ */
+void freeInternSet(InternSet* set);
+
+/**
+ * Grows the set so `count` strings fit without further resizing.
+ *
+ * @param set Set to grow
+ * @param count Expected total number of strings
+ */
+void internSetReserve(InternSet* set, int count);
+
+/**
+ * Finds a string with the given contents.
+ *
+ * @param set Set to search
+ * @param chars Raw string characters
+ * @param length String length in bytes
+ * @param hash Hash of the characters (see hashString())
+ * @return The stored string, or NULL if none matches
+ */
+ObjString* internSetFind(InternSet* set, char const* chars, int length, uint32_t hash);
+
+/**
+ * Adds a string known not to be in the set yet.
+ *
+ * @param set Set to modify
+ * @param string Hashed string to add
+ */
+void internSetAdd(InternSet* set, ObjString* string);
+
+/**
+ * Removes every string for which `isLive` returns false.
+ *
+ * This is the weak-reference hook for a collector: call it after
+ * marking and before sweeping, so the set never points at freed strings.
+ *
+ * @param set Set to prune
+ * @param isLive Predicate deciding which strings stay
+ */
+void internSetRemoveWhere(InternSet* set, bool (*isLive)(ObjString* string));
+
+#endif // INTERN_H
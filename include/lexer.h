@@ -1,6 +1,9 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <cstddef> // For size_t
+#include <cstdint> // For uint8_t, uint32_t
+
 /**
  * Enumeration of all token types recognized by the Delirium lexer.
  *
@@ -40,14 +43,19 @@ typedef enum TokenType {
     TOKEN_STRING,     // string literals
     TOKEN_NUMBER,     // numeric literals
 
-    // Keywords
-    TOKEN_AND,     // 'and'
-    TOKEN_CLASS,   // 'class'
-    TOKEN_ELSE,    // 'else'
-    TOKEN_FALSE,   // 'false'
-    TOKEN_FOR,     // 'for'
-    TOKEN_FUN,     // 'fun'
-    TOKEN_IF,      // 'if'
+    // Keywords (spelled out in the lexer's keyword table)
+    TOKEN_AND,      // 'and'
+    TOKEN_BREAK,    // 'break' (reserved)
+    TOKEN_CLASS,    // 'class'
+    TOKEN_CONTINUE, // 'continue' (reserved)
+    TOKEN_DO,       // 'do'
+    TOKEN_ELSE,     // 'else'
+    TOKEN_ELSEIF,   // 'elseif'
+    TOKEN_FALSE,    // 'false'
+    TOKEN_FOR,      // 'for'
+    TOKEN_FUN,      // 'fun' or 'func'
+    TOKEN_IF,       // 'if'
+    TOKEN_IMPORT,   // 'import'
     TOKEN_NIL,     // 'nil'
     TOKEN_OR,      // 'or'
     TOKEN_PRINT,   // 'print'
@@ -86,6 +94,7 @@ typedef struct Lexer {
     char const* current; // Current position in source
     int line;            // Current line number (1-based)
     char const* source;
+    char const* end; // One past the last source character
 } Lexer;
 
 // Change from extern variable to function access
@@ -94,11 +103,22 @@ char const* getLexer(); // Add this declaration
 /**
  * Initializes the lexer with source code to tokenize.
  *
- * @param source Null-terminated source code string
+ * @param source Source code (need not be null-terminated)
+ * @param length Length of the source in bytes
  *
  * @note The source string must remain valid during tokenization
  */
-void initLexer(char const* source);
+void initLexer(char const* source, size_t length);
+
+/**
+ * Repositions the lexer inside the source it was initialized with.
+ *
+ * @param start Position to resume scanning from
+ * @param line  Line number of `start`
+ *
+ * @note Used to compile a function body after the rest of the script
+ */
+void resetLexer(char const* start, int line);
 
 /**
  * Scans and returns the next token from the source.
@@ -110,4 +130,62 @@ void initLexer(char const* source);
  */
 Token scanToken();
 
+// ======================
+// Token Stream
+// ======================
+
+/**
+ * A whole source file lexed up front.
+ *
+ * Tokens are stored as parallel arrays rather than an array of Token, so
+ * the lexing loop writes 9 bytes per token and the parser reads them
+ * sequentially. Lines are not stored per token: `lineStarts` holds the
+ * offset of every line, and a token's line is found by walking that
+ * index forward as the stream is consumed (see streamToken()).
+ *
+ * For TOKEN_ERROR entries, `offsets` is the position the error was
+ * detected at and `lengths` indexes `messages`.
+ */
+typedef struct TokenStream {
+    char const* source;    // Source the offsets refer to
+    int count;             // Number of tokens (the last is TOKEN_EOF)
+    int capacity;          // Allocated size of the token arrays
+    uint8_t* types;        // TokenType of each token
+    uint32_t* offsets;     // Byte offset of each token in `source`
+    uint32_t* lengths;     // Length of each token in bytes
+    int lineCount;         // Number of entries in `lineStarts`
+    uint32_t* lineStarts;  // Offset of the first byte of each line
+    int messageCount;      // Number of lexical errors
+    char const** messages; // Messages of the TOKEN_ERROR entries
+} TokenStream;
+
+/**
+ * Lexes an entire source into a token stream.
+ *
+ * @param stream Stream to fill (any previous contents are discarded)
+ * @param source Source code (need not be null-terminated)
+ * @param length Length of the source in bytes
+ * @return false if the source is too large for 32-bit offsets; the
+ *         stream is left empty and scanToken() must be used instead
+ *
+ * @note Leaves the lexer initialized on `source`, positioned at the end
+ */
+bool tokenizeSource(TokenStream* stream, char const* source, size_t length);
+
+/**
+ * Rebuilds the Token at `index` of a stream.
+ *
+ * @param stream Stream produced by tokenizeSource()
+ * @param index Token to rebuild
+ * @param lineCursor Line index position; start at 0 and pass the same
+ *                   cursor for every call, in increasing token order
+ * @return Token equivalent to the one scanToken() would have returned
+ */
+Token streamToken(TokenStream const* stream, int index, int* lineCursor);
+
+/**
+ * Releases the arrays of a token stream.
+ */
+void freeTokenStream(TokenStream* stream);
+
 #endif // LEXER_H
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define MEMORY_H
 
 #include "common.h" // For size_t and other basic types
+#include "intern.h" // For InternSet
 #include "object.h" // For object-related memory operations
 
 // ======================
@@ -64,6 +65,125 @@
  */
 #define FREE(type, pointer) reallocate(pointer, sizeof(type), 0)
 
+// ======================
+// Pool Allocator
+// ======================
+
+/** Block size step between two neighbouring size classes */
+#define POOL_GRANULE 16
+
+/** Number of small-object size classes (16, 32, ..., 256 bytes) */
+#define POOL_CLASS_COUNT 16
+
+/** Largest request served from the pools; bigger ones go to malloc */
+#define POOL_MAX_SIZE (POOL_GRANULE * POOL_CLASS_COUNT)
+
+/** Bytes requested from the system for each slab page */
+#define POOL_SLAB_SIZE (64 * 1024)
+
+/** A free block, threaded through its own storage */
+typedef struct PoolBlock {
+    struct PoolBlock* next; // Next free block of the same class
+} PoolBlock;
+
+/** Header of a slab page; blocks of a single size class follow it */
+typedef struct PoolSlab {
+    struct PoolSlab* next; // Previously allocated slab
+    size_t padding;        // Keeps the first block 16-byte aligned
+} PoolSlab;
+
+/**
+ * Allocation counters for one size class (or for large blocks).
+ */
+typedef struct PoolStats {
+    size_t allocations; // Blocks handed out
+    size_t frees;       // Blocks returned
+    size_t live;        // Blocks currently in use
+    size_t peak;        // Highest value of live
+    size_t slabs;       // Slab pages carved for this class
+} PoolStats;
+
+/**
+ * VM-owned small-object allocator behind reallocate().
+ *
+ * Each size class keeps a free list of returned blocks and a bump region
+ * in its newest slab, so untouched slab memory is never paged in.
+ */
+typedef struct Allocator {
+    PoolBlock* freeLists[POOL_CLASS_COUNT]; // Returned blocks per class
+    uint8_t* bump[POOL_CLASS_COUNT];        // Next never-used block per class
+    uint8_t* bumpEnd[POOL_CLASS_COUNT];     // End of the current slab per class
+    PoolSlab* slabs;                        // Every slab, for release at shutdown
+    PoolStats stats[POOL_CLASS_COUNT];      // Per-class counters
+    PoolStats large;                        // Counters for system-allocated blocks
+} Allocator;
+
+/**
+ * Prepares the allocator with empty pools.
+ *
+ * @param allocator Allocator to initialize
+ */
+void initAllocator(Allocator* allocator);
+
+/**
+ * Returns every slab page to the system.
+ *
+ * @param allocator Allocator to release
+ *
+ * @note Must run after all pooled blocks are freed
+ */
+void freeAllocator(Allocator* allocator);
+
+/**
+ * Prints per-size-class allocation statistics to stderr.
+ *
+ * @param allocator Allocator to report on
+ */
+void printAllocatorStats(Allocator* allocator);
+
+// ======================
+// Local Heaps
+// ======================
+
+/**
+ * Allocations of a thread that compiles alongside the VM's own thread.
+ *
+ * While a thread uses a local heap, reallocate() serves it from the
+ * heap's pools, new objects go on the heap's object list, and strings
+ * that are not in vm.strings yet are interned in the heap's own set, so
+ * the thread never writes to VM-wide state. The VM's thread folds the
+ * heap into the VM with mergeLocalHeap() once the thread is done.
+ *
+ * @note The VM's own structures may be read meanwhile but not changed
+ */
+typedef struct LocalHeap {
+    Allocator allocator; // Small-object pools of the thread
+    Obj* objects;        // Objects allocated by the thread
+    InternSet strings;   // Strings interned by the thread
+} LocalHeap;
+
+/** Local heap of the calling thread, or NULL when it uses the VM's */
+extern thread_local LocalHeap* localHeap;
+
+/**
+ * Prepares an empty local heap.
+ *
+ * @param heap Heap to initialize
+ */
+void initLocalHeap(LocalHeap* heap);
+
+/**
+ * Moves a finished local heap into the VM.
+ *
+ * Strings the heap interned become canonical in vm.strings unless an
+ * equal string is there already, in which case references to the copy
+ * are redirected to it and the copy is freed. Slabs and free blocks join
+ * vm.allocator and the objects join vm.objects.
+ *
+ * @param heap Heap no thread uses any more; left empty
+ */
+void mergeLocalHeap(LocalHeap* heap);
+
 // ======================
 // Core Memory Functions
 // ======================
@@ -80,6 +200,8 @@
  * @return Pointer to allocated memory (NULL if freeing)
  *
  * @note All memory operations should go through this function
+ * @note oldSize must match the size the block was allocated with, since
+ *       it selects the pool the block is returned to
  */
 void* reallocate(void* pointer, size_t oldSize, size_t newSize);
 
@@ -0,0 +1,113 @@
+#ifndef MODULE_H
+#define MODULE_H
+
+#include <functional> // For worker tasks
+#include <string>     // For paths and file contents
+#include <vector>     // For the imports of a module
+
+#include "common.h" // For basic types
+#include "lexer.h"  // For TokenStream
+#include "object.h" // For ObjModule
+
+// ======================
+// Module Sources
+// ======================
+
+/**
+ * A source file reachable through `import`, cached for the whole process.
+ *
+ * Entries are keyed by canonical path. The file is read and lexed once
+ * and compiled once, both possibly on a worker thread (see
+ * prefetchModules() and forEachParallel()).
+ * A later import of the same path re-reads the file and compares
+ * `hash`. It reuses the compiled module when the contents are unchanged.
+ * Otherwise it replaces the entry with a fresh one. Replaced entries stay
+ * alive because functions compiled from them point into `text`.
+ */
+typedef struct ModuleSource {
+    std::string path;                          // Canonical path of the file
+    std::string name;                          // Namespace: file name without directory and ".del"
+    std::string text;                          // File contents
+    uint64_t hash;                             // Hash of `text`
+    bool lexed;                                // true while `tokens` holds the lexed contents
+    bool compiling;                            // true while the compiler is inside this module
+    TokenStream tokens;                        // Lexed contents (released once compiled)
+    ObjModule* module;                         // Compiled module (NULL until compiled)
+    std::vector<struct ModuleSource*> imports; // Modules its top level imports, in order
+} ModuleSource;
+
+/**
+ * Resolves an import path relative to the file that contains the import.
+ *
+ * @param importer Path of the importing file ("-" for standard input)
+ * @param chars Path as written in the import statement
+ * @param length Length of the written path
+ * @return Canonical path when the file exists, the joined path otherwise
+ */
+std::string resolveModulePath(std::string const& importer, char const* chars, int length);
+
+/**
+ * Returns the cache entry for a module, reading and lexing it if needed.
+ *
+ * @param path Path returned by resolveModulePath()
+ * @return Entry for the current contents of the file, or NULL if it
+ *         could not be read
+ */
+ModuleSource* loadModule(std::string const& path);
+
+/**
+ * Reads and lexes modules that are not cached yet, in parallel.
+ *
+ * @param paths Paths returned by resolveModulePath()
+ * @param count Number of paths
+ *
+ * @note Returns once every file has been read and lexed
+ */
+void prefetchModules(std::string const* paths, int count);
+
+/**
+ * Returns the cache entry for a path without reading anything.
+ *
+ * @param path Path returned by resolveModulePath()
+ * @return The entry, or NULL if the path was never loaded
+ *
+ * @note Only reads the cache, so worker threads may call it while the
+ *       main thread waits for them
+ */
+ModuleSource* findModule(std::string const& path);
+
+/**
+ * Runs a task for every index on worker threads.
+ *
+ * @param count Number of indices
+ * @param task Called once per index, possibly on several threads at once
+ *
+ * @note Returns once every task has finished
+ */
+void forEachParallel(size_t count, std::function<void(size_t)> const& task);
+
+/**
+ * Reserves a module's namespace for the current run.
+ *
+ * Module globals live in vm.globals under "<namespace>.<name>", so two
+ * files with the same name would overwrite each other's globals.
+ *
+ * @param source Entry of the module being imported
+ * @return NULL if the namespace was free or already belongs to the same
+ *         file, otherwise the path of the file holding it
+ */
+std::string const* claimModuleName(ModuleSource const* source);
+
+/**
+ * Frees every namespace, for a new script run in the same VM.
+ */
+void releaseModuleNames();
+
+/**
+ * Releases every cached module source.
+ *
+ * @note The module objects themselves belong to the VM's object list
+ */
+void freeModules();
+
+#endif // MODULE_H
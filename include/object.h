@@ -1,6 +1,8 @@
 #ifndef OBJECT_H
 #define OBJECT_H
 
+#include <cstddef> // For offsetof
+
 #include "chunk.h"  // For Chunk definition
 #include "common.h" // For basic types
 #include "value.h"  // For Value type
@@ -21,6 +23,18 @@
 /** Checks if a Value is a string object */
 #define IS_STRING(value) isObjType(value, OBJ_STRING)
 
+/** Checks if a Value is an unflattened concatenation */
+#define IS_ROPE(value) isObjType(value, OBJ_ROPE)
+
+/** Checks if a Value is string-typed (flat string or rope) */
+#define IS_ANY_STRING(value) (IS_STRING(value) || IS_ROPE(value))
+
+/** Checks if a Value is a string builder */
+#define IS_STRING_BUILDER(value) isObjType(value, OBJ_STRING_BUILDER)
+
+/** Checks if a Value is an imported module */
+#define IS_MODULE(value) isObjType(value, OBJ_MODULE)
+
 // ======================
 // Object Type Casting
 // ======================
@@ -37,6 +51,15 @@
 /** Gets the C string buffer from a string object Value */
 #define AS_CSTRING(value) (((ObjString*)AS_OBJ(value))->chars)
 
+/** Safely casts an object Value to ObjRope* */
+#define AS_ROPE(value) ((ObjRope*)AS_OBJ(value))
+
+/** Safely casts an object Value to ObjStringBuilder* */
+#define AS_STRING_BUILDER(value) ((ObjStringBuilder*)AS_OBJ(value))
+
+/** Safely casts an object Value to ObjModule* */
+#define AS_MODULE(value) ((ObjModule*)AS_OBJ(value))
+
 // ======================
 // Object Type Enum
 // ======================
@@ -49,7 +72,10 @@
 typedef enum ObjType {
     OBJ_FUNCTION, // User-defined functions
     OBJ_NATIVE,   // C-implemented native functions
-    OBJ_STRING    // String objects (interned)
+    OBJ_STRING,        // String objects (interned)
+    OBJ_ROPE,          // Lazy string concatenations
+    OBJ_STRING_BUILDER, // Mutable text buffers
+    OBJ_MODULE          // Imported source files
 } ObjType;
 
 // ======================
@@ -70,6 +96,16 @@ struct Obj {
 // Function Object
 // ======================
 
+/**
+ * A range of source text, used to locate a function's parameter list
+ * and body inside the script it was declared in.
+ */
+typedef struct SourceSpan {
+    char const* start; // First character of the span ('(' of the parameters)
+    int length;        // Length in bytes (through the closing '}')
+    int line;          // Line number of the first character
+} SourceSpan;
+
 /**
  * Represents a user-defined Delirium function.
  *
@@ -80,6 +116,8 @@ typedef struct ObjFunction {
     int arity;       // Number of parameters
     Chunk chunk;     // Compiled function body
     ObjString* name; // Function name (or NULL for anonymous)
+    SourceSpan body; // Source of the parameters and body (empty for scripts)
+    bool compiled;   // false while the function is a lazy stub
 } ObjFunction;
 
 // ======================
@@ -110,15 +148,94 @@ typedef struct {
 /**
  * Represents a Delirium string value.
  *
- * Strings are immutable and interned for deduplication.
+ * Strings are immutable. The characters are stored inline after the
+ * header, so a string is one allocation of STRING_SIZE(length) bytes.
+ *
+ * Strings from source code and native names are interned for
+ * deduplication. Strings created at runtime (concatenation results) are
+ * not: their hash is computed on first request and they are compared by
+ * content, so building and printing a string never touches vm.strings.
  */
 struct ObjString {
     Obj obj;       // Base object header
     int length;    // String length in bytes (excluding null terminator)
-    char* chars;   // UTF-8 character data (always null-terminated)
-    uint32_t hash; // Precomputed FNV-1a hash of string contents
+    uint32_t hash; // Hash of string contents (valid once `hashed`)
+    bool hashed;   // true once `hash` has been computed
+    bool interned; // true if this is the canonical copy in vm.strings
+    char chars[1]; // UTF-8 character data (always null-terminated)
 };
 
+/**
+ * Allocation size of a string object holding `length` characters.
+ * `chars` is declared with one element (flexible array members are not
+ * standard C++), so the size is measured from its offset.
+ */
+#define STRING_SIZE(length) (offsetof(ObjString, chars) + (size_t)(length) + 1)
+
+// ======================
+// Rope Object
+// ======================
+
+/**
+ * Concatenations shorter than this are copied into a flat string right
+ * away; copying a few bytes is cheaper than a rope node and a later flatten.
+ */
+#define ROPE_MIN_LENGTH 64
+
+/**
+ * Represents the result of a string concatenation that has not been
+ * copied yet.
+ *
+ * Both children are ObjString or ObjRope. The characters are produced on
+ * first use (printing, comparison, hashing) by flattenRope(), which walks
+ * the tree iteratively, so appending to a long string costs O(1) and
+ * building a string piecewise is linear overall.
+ */
+typedef struct ObjRope {
+    Obj obj;         // Base object header
+    int length;      // Total length in bytes
+    int depth;       // Height of the tree (a flat string counts as 0)
+    Obj* left;       // Left part (ObjString or ObjRope)
+    Obj* right;      // Right part (ObjString or ObjRope)
+    ObjString* flat; // Flattened string (NULL until first use)
+} ObjRope;
+
+// ======================
+// String Builder Object
+// ======================
+
+/**
+ * A mutable text buffer for assembling strings piecewise.
+ *
+ * Exposed to scripts through the builder(), append(), build() and
+ * length() natives. The buffer grows geometrically, so appends are
+ * amortized O(1), and build() makes a single string allocation.
+ */
+typedef struct ObjStringBuilder {
+    Obj obj;      // Base object header
+    int length;   // Bytes written so far
+    int capacity; // Allocated size of `chars`
+    char* chars;  // Buffer (not null-terminated)
+} ObjStringBuilder;
+
+// ======================
+// Module Object
+// ======================
+
+/**
+ * A source file compiled by an `import` statement.
+ *
+ * The module's top-level code runs the first time an import of it is
+ * executed; later imports of the same file reuse the object and skip it.
+ * Its globals live in vm.globals under "<name>.<global>".
+ */
+typedef struct ObjModule {
+    Obj obj;               // Base object header
+    ObjString* name;       // Namespace (file name without ".del")
+    ObjFunction* function; // Top-level code of the module
+    bool executed;         // true once the top-level code has started
+} ObjModule;
+
 // ======================
 // Object API
 // ======================
@@ -129,6 +246,33 @@ ObjFunction* newFunction();
 /** Wraps a C function as a native Delirium function */
 ObjNative* newNative(NativeFn function);
 
+/**
+ * Creates a module object for compiled top-level code.
+ *
+ * @param name Namespace of the module
+ * @param function Compiled top-level code
+ */
+ObjModule* newModule(ObjString* name, ObjFunction* function);
+
+/** Creates a new empty string builder */
+ObjStringBuilder* newStringBuilder();
+
+/**
+ * Appends the printed form of a value to a string builder.
+ *
+ * @param builder Builder to append to
+ * @param value Any value; strings and ropes are copied directly and
+ *              numbers are formatted straight into the buffer
+ */
+void builderAppend(ObjStringBuilder* builder, Value value);
+
+/**
+ * Copies a builder's current contents into a new string.
+ *
+ * @return Runtime (uninterned) string; the builder is left unchanged
+ */
+ObjString* builderToString(ObjStringBuilder* builder);
+
 /**
  * Creates a new string object by copying existing characters.
  *
@@ -142,15 +286,100 @@ ObjString* copyString(char const* chars, int length);
 void printObject(Value value);
 
 /**
- * Creates a string object taking ownership of existing characters.
+ * Concatenates two string-typed values.
+ *
+ * @param a Left operand (string or rope)
+ * @param b Right operand (string or rope)
+ * @return A flat runtime string for short results, otherwise a rope
+ */
+Value concatenateStrings(Value a, Value b);
+
+/**
+ * Concatenates several string-typed values in order.
+ *
+ * Adjacent short flat parts are copied together into one string sized
+ * once; long parts and ropes are joined by rope nodes without copying.
+ *
+ * @param parts Operands (strings or ropes)
+ * @param count Number of operands
+ * @return The concatenation of all parts
+ */
+Value concatenateParts(Value* parts, int count);
+
+/**
+ * Produces (once) and returns the flat string of a rope.
+ *
+ * @param rope Rope to flatten
+ * @return A runtime (uninterned) string with the rope's characters
+ */
+ObjString* flattenRope(ObjRope* rope);
+
+/**
+ * Returns the flat string for a string-typed value.
+ *
+ * @param value String or rope value
+ * @return The value itself for strings, the flattened rope otherwise
+ */
+ObjString* flatString(Value value);
+
+/**
+ * Returns the length of a string-typed value without flattening it.
+ */
+int stringLength(Value value);
+
+/**
+ * Allocates a string object whose characters the caller fills in.
  *
- * @param chars Character buffer (takes ownership)
  * @param length String length in bytes
- * @return New interned string object
+ * @return Unhashed, uninterned string with a null terminator in place
+ *
+ * @note The string is not tracked by the VM until passed to takeString()
+ */
+ObjString* makeString(int length);
+
+/**
+ * Interns a string object built with makeString().
+ *
+ * @param string String whose characters have been written (takes ownership)
+ * @return The interned string; `string` itself is freed if an equal
+ *         string already exists
+ */
+ObjString* takeString(ObjString* string);
+
+/**
+ * Tracks a string object built with makeString() without interning it.
+ *
+ * @param string String whose characters have been written (takes ownership)
+ * @return The same string, now owned by the VM
+ *
+ * @note The hash is left to be computed by stringHash() when needed
+ */
+ObjString* adoptString(ObjString* string);
+
+/**
+ * Returns the hash of a string, computing it on first use.
+ */
+uint32_t stringHash(ObjString* string);
+
+/**
+ * Returns the interned string with the same contents.
+ *
+ * @param string Interned or runtime string
+ * @return `string` itself if already interned or if no equal string was
+ *         interned yet (it then becomes the canonical copy), otherwise
+ *         the existing interned string
+ *
+ * @note Required before a runtime string is used as a table key
+ */
+ObjString* internString(ObjString* string);
+
+/**
+ * Compares two strings by content.
  *
- * @note The buffer must be heap-allocated and null-terminated
+ * @note Two distinct interned strings are known to differ without
+ *       looking at their characters
  */
-ObjString* takeString(char* chars, int length);
+bool stringsEqual(ObjString* a, ObjString* b);
 
 // ======================
 // Type Checking Utility
@@ -0,0 +1,94 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "common.h" // For size_t
+
+// ======================
+// Output Configuration
+// ======================
+
+/**
+ * Size of the VM's output buffer. Output is written to the file
+ * descriptor in chunks of up to this many bytes.
+ */
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+/**
+ * When buffered output is written to the file descriptor.
+ */
+typedef enum OutputMode {
+    OUTPUT_FULL,      // When the buffer fills (files and pipes)
+    OUTPUT_LINE,      // After every newline (terminals)
+    OUTPUT_UNBUFFERED // After every write
+} OutputMode;
+
+// ======================
+// Output Buffer
+// ======================
+
+/**
+ * Buffered writer for everything a script prints.
+ *
+ * The print opcodes and value printers append here instead of going
+ * through stdio or iostreams, so printing a line costs a memcpy and the
+ * write() system call is made once per buffer (or per line on a
+ * terminal). The buffer must be flushed before anything else is written
+ * to the same descriptor and before the process exits.
+ */
+typedef struct Output {
+    int fd;                          // Descriptor written to on flush
+    OutputMode mode;                 // Flush policy
+    size_t length;                   // Bytes waiting in `buffer`
+    char buffer[OUTPUT_BUFFER_SIZE]; // Pending output
+} Output;
+
+/**
+ * Initializes an output buffer for a file descriptor.
+ *
+ * @param output Buffer to prepare
+ * @param fd Descriptor to write to
+ *
+ * @note Picks OUTPUT_LINE when `fd` is a terminal, OUTPUT_FULL otherwise
+ */
+void initOutput(Output* output, int fd);
+
+/**
+ * Changes the flush policy, flushing pending output first.
+ */
+void setOutputMode(Output* output, OutputMode mode);
+
+/**
+ * Appends bytes to an output buffer.
+ *
+ * @param output Buffer to append to
+ * @param chars Bytes to write (need not be null-terminated)
+ * @param length Number of bytes
+ */
+void outputWrite(Output* output, char const* chars, size_t length);
+
+/**
+ * Appends a null-terminated string to an output buffer.
+ */
+void outputString(Output* output, char const* string);
+
+/**
+ * Appends printf-style formatted text to an output buffer.
+ *
+ * @param output Buffer to append to
+ * @param format printf-style format string
+ */
+void outputFormat(Output* output, char const* format, ...);
+
+/**
+ * Ends a line, flushing it when the buffer is line-buffered.
+ */
+void outputNewline(Output* output);
+
+/**
+ * Writes all pending output to the file descriptor.
+ *
+ * @note Write errors (e.g. a closed pipe) discard the pending output
+ */
+void flushOutput(Output* output);
+
+#endif // OUTPUT_H
@@ -0,0 +1,66 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string> // For script paths
+
+// ======================
+// Script Server
+// ======================
+
+/**
+ * Runs one script in the current VM.
+ *
+ * @param path Script path, or "-" for standard input
+ * @return Process exit status for the run (0, 64, 65, 70 or 74)
+ */
+typedef int (*ScriptRunner)(std::string const& path);
+
+/**
+ * How a server gives each request its VM.
+ */
+typedef enum {
+    SERVE_RESET, // Run in-process between initVM() and freeVM()
+    SERVE_FORK,  // Run in a forked child sharing the warm VM copy-on-write
+} ServeMode;
+
+/**
+ * Environment variable naming a server socket. When it is set, a plain
+ * `delirium script.del` forwards the run to that server, and runs locally
+ * if the server cannot be reached.
+ */
+#define SERVER_SOCKET_ENV "DELIRIUM_SOCKET"
+
+/**
+ * Serves script runs on a Unix domain socket until the process is killed.
+ *
+ * Each connection carries one request: the client's working directory,
+ * its arguments, and its standard input, output and error descriptors
+ * (passed with SCM_RIGHTS). The run's descriptors 0-2 point at the
+ * client's, so output streams straight to the client, and the server
+ * replies with the exit status.
+ *
+ * With SERVE_RESET the VM must be uninitialized; each run gets a fresh
+ * one. With SERVE_FORK the caller initializes the VM (and may run a
+ * prelude) first; each run happens in a child process that starts from
+ * that state and exits afterwards, so runs are isolated from the server
+ * and from each other. Each child logs its latency and the pages it
+ * copied to the server's stderr.
+ *
+ * @param socketPath Filesystem path of the socket (replaced if present)
+ * @param run Runs a script
+ * @param mode How each request gets its VM
+ * @return Exit status if the socket could not be set up
+ */
+int serveScripts(char const* socketPath, ScriptRunner run, ServeMode mode);
+
+/**
+ * Sends a script run to a server and waits for it to finish.
+ *
+ * @param socketPath Filesystem path of the server's socket
+ * @param argc Number of arguments (the script path comes first)
+ * @param argv Arguments
+ * @return Exit status of the run, or -1 if no server accepted the request
+ */
+int runRemote(char const* socketPath, int argc, char** argv);
+
+#endif // SERVER_H
@@ -4,37 +4,34 @@
 #include "common.h" // For basic type definitions
 #include "value.h"  // For Value type
 
-// ======================
-// Hash Table Entry
-// ======================
-
-/**
- * Represents a single key-value pair in the hash table.
- *
- * The table uses open addressing with linear probing for collision resolution.
- * Tombstone entries (key=NULL, value=NIL) mark deleted slots.
- */
-typedef struct Entry {
-    ObjString* key; // String key (interned/unique strings only)
-    Value value;    // Associated value (any Delirium type)
-} Entry;
-
 // ======================
 // Hash Table Structure
 // ======================
 
+/** Number of slots probed together (one SSE2 register of control bytes) */
+#define TABLE_GROUP_WIDTH 16
+
 /**
  * Dynamic hash table implementation used for:
  * - Global variables
- * - String interning
  * - Object properties
  *
- * Implements a key-value store with O(1) average case operations.
+ * Open addressing in the style of SwissTable. Every slot has a control
+ * byte: CTRL_EMPTY, CTRL_DELETED (tombstone), or the low 7 bits of the
+ * key's hash for a full slot. Lookups scan groups of TABLE_GROUP_WIDTH
+ * control bytes at a time and only touch keys whose 7-bit fragment
+ * matches. Keys and values live in separate arrays so probing never pulls
+ * values into cache.
+ *
+ * The capacity is zero or a power of two no smaller than TABLE_GROUP_WIDTH.
  */
 typedef struct Table {
-    int count;      // Number of active entries (excluding tombstones)
-    int capacity;   // Total allocated slots in entries array
-    Entry* entries; // Array of slots (size = capacity)
+    int count;        // Number of live entries
+    int tombstones;   // Number of deleted slots not yet reclaimed
+    int capacity;     // Total number of slots
+    uint8_t* control; // Control byte per slot
+    ObjString** keys; // Key per slot (interned strings only)
+    Value* values;    // Value per slot
 } Table;
 
 // ======================
@@ -67,7 +64,7 @@ void freeTable(Table* table);
  * @param value Value to associate with key
  * @return true if new entry was created, false if existing entry was updated
  *
- * @note Grows table automatically if load factor exceeds 75%
+ * @note Grows table automatically if more than 7/8 of slots are in use
  */
 bool tableSet(Table* table, ObjString* key, Value value);
 
@@ -96,24 +93,24 @@ bool tableGet(Table* table, ObjString* key, Value* value);
  * @param key Key to remove
  * @return true if entry was found and removed, false otherwise
  *
- * @note Leaves a tombstone entry to maintain probe sequences
+ * @note Leaves a tombstone unless no probe sequence passes the slot
  */
 bool tableDelete(Table* table, ObjString* key);
 
 // ======================
-// String Interning
+// Lookup by Content
 // ======================
 
 /**
- * Finds an interned string in the table by content.
+ * Finds a string key in the table by content.
  *
- * @param table String intern table
+ * @param table Table to search
  * @param chars Raw string characters
  * @param length String length in bytes
- * @param hash Precomputed FNV-1a hash of the string
+ * @param hash Precomputed hash of the string (see hashString())
  * @return Existing ObjString if found, NULL otherwise
  *
- * @note Used for string deduplication (interning)
+ * @note The VM's own interning uses InternSet (see intern.h)
  */
 ObjString* tableFindString(Table* table, char const* chars, int length, uint32_t hash);
 
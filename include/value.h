@@ -125,6 +125,24 @@ void writeValueArray(ValueArray* array, Value value);
 /** Releases all memory used by a ValueArray */
 void freeValueArray(ValueArray* array);
 
+/**
+ * Size of a buffer that holds any number written by formatNumber().
+ */
+#define NUMBER_BUFFER_SIZE 32
+
+/**
+ * Writes the printed form of a number.
+ *
+ * Integral values (up to 2^53, or 999999 with NUMBER_FORMAT_GENERAL) are
+ * written as plain integers. Other values use the shortest text that reads
+ * back as the same double, or printf's "%g" with NUMBER_FORMAT_GENERAL.
+ *
+ * @param buffer Destination of at least NUMBER_BUFFER_SIZE bytes
+ * @param number Number to format
+ * @return Number of characters written (no null terminator)
+ */
+int formatNumber(char* buffer, double number);
+
 /**
  * Prints a Value to stdout according to its type:
  * - Numbers: decimal format
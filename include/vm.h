@@ -1,8 +1,13 @@
 #ifndef VM_H
 #define VM_H
 
+#include <string> // For the script path
+
 #include "chunk.h"  // Bytecode chunk definitions
+#include "intern.h" // String intern set
+#include "memory.h" // Allocator state
 #include "object.h" // Object system definitions
+#include "output.h" // Buffered script output
 #include "table.h"  // Hash table implementation
 #include "value.h"  // Value type definitions
 
@@ -52,9 +57,15 @@ typedef struct VM {
     Value* stackTop;        // Top of the value stack
 
     Table globals; // Global variables
-    Table strings; // String interning table
+    InternSet strings; // Interned strings
 
     Obj* objects; // Linked list of all heap-allocated objects
+
+    Allocator allocator; // Size-class pools behind reallocate()
+
+    Output output; // Buffered standard output of the script
+
+    bool mutateOnError; // Errors rewrite the script (DEBUG_MUTATE_CODE builds)
 } VM;
 
 // ======================
@@ -102,13 +113,28 @@ void initVM();
  */
 void freeVM();
 
+/**
+ * Clears what the last script left in the global namespace so another
+ * script can run in the same VM.
+ *
+ * Natives are defined afresh and imported modules run again on their next
+ * import, under namespaces claimed afresh. Interned strings, compiled code
+ * and the module cache are kept.
+ */
+void resetGlobals();
+
 /**
  * Main entry point for executing Delirium source code.
  *
- * @param source Null-terminated source code string
+ * @param source Source code (need not be null-terminated)
+ * @param length Length of the source in bytes
+ * @param path Path the source was loaded from (used by the mutator)
  * @return Interpretation result code
+ *
+ * @note The source must stay valid until the VM is freed, since lazily
+ *       compiled functions are read from it when first called
  */
-InterpretResult interpret(char const* source, std::string& path);
+InterpretResult interpret(char const* source, size_t length, std::string& path);
 
 /**
  * Pushes a value onto the VM's stack.
@@ -0,0 +1,29 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "server.h" // For ScriptRunner
+
+// ======================
+// Watch Mode
+// ======================
+
+/** Quiet period after a change before the script reruns (milliseconds) */
+#define WATCH_SETTLE_MS 50
+
+/**
+ * Runs a script, then reruns it whenever a .del file in its directory
+ * changes, until the process is killed.
+ *
+ * One VM serves every run: natives, interned strings, the module cache
+ * and the compiled top-level functions of the script stay warm, and only
+ * functions whose source changed are recompiled (see
+ * enableFunctionCache()). Globals are cleared between runs, and errors
+ * are reported instead of mutating the watched file.
+ *
+ * @param path Script to watch
+ * @param run Runs a script in the current VM
+ * @return Exit status if the script could not be watched
+ */
+int watchScript(char const* path, ScriptRunner run);
+
+#endif // WATCH_H
@@ -0,0 +1,47 @@
+#!/bin/bash
+set -e  # Exit if any command fails
+
+# Times the interpreter on the scripts in benchmarks/ and on a generated
+# large source that stresses the lexer, compiler and string interning.
+#
+# Usage: scripts/benchmark.sh [delirium-binary ...]
+# With several binaries (e.g. builds with different -D options) each one
+# is timed on the same inputs so the results can be compared directly.
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+RUNS=${RUNS:-5}
+
+BINARIES=("$@")
+if [ ${#BINARIES[@]} -eq 0 ]; then
+    BINARIES=("$PROJECT_ROOT/build/delirium")
+fi
+
+# Scripts are run from a scratch copy: a failing run may rewrite its input
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+cp "$PROJECT_ROOT"/benchmarks/*.del "$WORK_DIR"
+
+# Large source: many distinct globals and string literals, run once
+GENERATED="$WORK_DIR/large_source.del"
+for i in $(seq 1 100000); do
+    echo "var identifier_number_$i = \"string literal number $i\";"
+done > "$GENERATED"
+echo "println identifier_number_100000;" >> "$GENERATED"
+
+for binary in "${BINARIES[@]}"; do
+    echo "==> $binary"
+    for script in "$WORK_DIR"/*.del; do
+        best=""
+        for run in $(seq 1 "$RUNS"); do
+            mkdir -p "$WORK_DIR/run"
+            cp "$script" "$WORK_DIR/run/input.del"
+            start=$(date +%s.%N)
+            "$binary" "$WORK_DIR/run/input.del" > /dev/null
+            end=$(date +%s.%N)
+            best=$(awk -v s="$start" -v e="$end" -v b="$best" \
+                'BEGIN { t = e - s; if (b == "" || t < b) b = t; print b }')
+        done
+        printf "    %-24s %8.4fs (best of %d)\n" "$(basename "$script")" "$best" "$RUNS"
+    done
+done
@@ -0,0 +1,113 @@
+#include <cstdlib>  // For malloc/free
+#include <cstring>  // For memcpy
+#include <iostream> // For error output
+
+#include "arena.h" // For arena interface
+
+// Minimum usable size of an arena block
+#define ARENA_BLOCK_MIN (64 * 1024)
+
+// Alignment of every arena allocation
+#define ARENA_ALIGN 16
+
+/**
+ * Rounds a size up to the arena alignment.
+ */
+static size_t alignSize(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+/**
+ * Returns the first usable byte of a block.
+ */
+static uint8_t* blockData(ArenaBlock* block)
+{
+    return (uint8_t*)block + alignSize(sizeof(ArenaBlock));
+}
+
+/**
+ * Initializes an empty arena.
+ *
+ * @param arena Arena to prepare
+ */
+void initArena(Arena* arena)
+{
+    arena->head = NULL;
+    arena->last = NULL;
+}
+
+/**
+ * Allocates memory from the arena, starting a new block if needed.
+ *
+ * @param arena Arena to allocate from
+ * @param size Bytes requested
+ * @return Pointer to uninitialized memory
+ */
+void* arenaAllocate(Arena* arena, size_t size)
+{
+    size = alignSize(size);
+
+    ArenaBlock* block = arena->head;
+    if (block == NULL || block->size - block->used < size) {
+        size_t blockSize = size > ARENA_BLOCK_MIN ? size : ARENA_BLOCK_MIN;
+        block = (ArenaBlock*)malloc(alignSize(sizeof(ArenaBlock)) + blockSize);
+        if (block == NULL) {
+            std::cerr << "[Delirium] Memory allocation failed" << std::endl;
+            exit(1);
+        }
+        block->next = arena->head;
+        block->size = blockSize;
+        block->used = 0;
+        arena->head = block;
+    }
+
+    void* result = blockData(block) + block->used;
+    block->used += size;
+    arena->last = result;
+    return result;
+}
+
+/**
+ * Resizes an arena allocation.
+ *
+ * @param arena Arena the allocation came from
+ * @param pointer Existing allocation (or NULL)
+ * @param oldSize Current size
+ * @param newSize Desired size
+ * @return Pointer to the resized allocation
+ *
+ * @note Only the most recent allocation can be extended in place
+ */
+void* arenaGrow(Arena* arena, void* pointer, size_t oldSize, size_t newSize)
+{
+    if (pointer != NULL && pointer == arena->last) {
+        ArenaBlock* block = arena->head;
+        size_t offset = (size_t)((uint8_t*)pointer - blockData(block));
+        if (offset + alignSize(newSize) <= block->size) {
+            block->used = offset + alignSize(newSize);
+            return pointer;
+        }
+    }
+
+    void* result = arenaAllocate(arena, newSize);
+    if (pointer != NULL)
+        memcpy(result, pointer, oldSize < newSize ? oldSize : newSize);
+    return result;
+}
+
+/**
+ * Releases all arena blocks.
+ *
+ * @param arena Arena to release
+ */
+void freeArena(Arena* arena)
+{
+    ArenaBlock* block = arena->head;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    initArena(arena);
+}
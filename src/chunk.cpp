@@ -1,6 +1,55 @@
-#include "chunk.h"
-#include "memory.h" // For GROW_ARRAY, FREE_ARRAY macros
-#include "value.h"  // For Value and ValueArray operations
+#include <cstring> // For memcpy
+
+#include "arena.h"    // For arrays grown during compilation
+#include "chunk.h"    // For Chunk declarations
+#include "codeheap.h" // For moving finished code into the code heap
+#include "memory.h"   // For GROW_ARRAY, FREE_ARRAY macros
+#include "value.h"    // For Value and ValueArray operations
+
+/**
+ * Grows one of a chunk's arrays, from its arena while it is compiling
+ * and from the heap otherwise.
+ */
+#define GROW_CHUNK_ARRAY(type, pointer, oldCount, newCount)          \
+    (type*)growChunkArray(chunk, pointer, sizeof(type) * (oldCount), \
+        sizeof(type) * (newCount))
+
+/**
+ * Frees one of a chunk's arrays unless its arena owns it.
+ */
+#define FREE_CHUNK_ARRAY(type, pointer, oldCount) \
+    do {                                          \
+        if (chunk->arena == NULL)                 \
+            FREE_ARRAY(type, pointer, oldCount);  \
+    } while (false)
+
+/**
+ * Resizes a chunk array in the chunk's arena, or on the heap.
+ */
+static void* growChunkArray(Chunk* chunk, void* pointer, size_t oldSize, size_t newSize)
+{
+    if (chunk->arena != NULL)
+        return arenaGrow(chunk->arena, pointer, oldSize, newSize);
+    return reallocate(pointer, oldSize, newSize);
+}
+
+/**
+ * Copies a finished chunk array into an exactly sized heap allocation.
+ */
+static void* promoteArray(Chunk* chunk, void* pointer, size_t size, size_t capacitySize)
+{
+    if (pointer == NULL || size == 0) {
+        if (chunk->arena == NULL)
+            reallocate(pointer, capacitySize, 0);
+        return NULL;
+    }
+
+    void* result = reallocate(NULL, 0, size);
+    memcpy(result, pointer, size);
+    if (chunk->arena == NULL)
+        reallocate(pointer, capacitySize, 0);
+    return result;
+}
 
 /**
  * Initializes a new empty bytecode chunk.
@@ -15,7 +64,13 @@ void initChunk(Chunk* chunk)
     chunk->count = 0;
     chunk->capacity = 0;
     chunk->code = NULL;
+    chunk->lineCount = 0;
+    chunk->lineCapacity = 0;
     chunk->lines = NULL;
+    chunk->constantIndex = NULL;
+    chunk->indexCapacity = 0;
+    chunk->sealed = false;
+    chunk->arena = NULL;
     initValueArray(&chunk->constants);
 }
 
@@ -27,34 +82,123 @@ void initChunk(Chunk* chunk)
  * @param line Source line number for debugging information
  *
  * @note Automatically grows the arrays if capacity is insufficient
- * @note Maintains parallel code/lines arrays for runtime debugging
+ * @note A new line run is only started when the line changes
  */
 void writeChunk(Chunk* chunk, uint8_t byte, int line)
 {
-    // Check if we need to grow the arrays
+    // Check if we need to grow the bytecode array
     if (chunk->capacity < chunk->count + 1) {
         int oldCapacity = chunk->capacity;
         chunk->capacity = GROW_CAPACITY(oldCapacity);
-
-        // Grow the bytecode array
-        chunk->code = GROW_ARRAY(
+        chunk->code = GROW_CHUNK_ARRAY(
             uint8_t,
             chunk->code,
             oldCapacity,
             chunk->capacity);
+    }
+
+    // Store the byte
+    chunk->code[chunk->count] = byte;
+    chunk->count++;
+
+    // Still on the same line as the previous byte: extend the current run
+    if (chunk->lineCount > 0 && chunk->lines[chunk->lineCount - 1].line == line)
+        return;
 
-        // Grow the line information array in parallel
-        chunk->lines = GROW_ARRAY(
-            int,
+    // Start a new line run
+    if (chunk->lineCapacity < chunk->lineCount + 1) {
+        int oldCapacity = chunk->lineCapacity;
+        chunk->lineCapacity = GROW_CAPACITY(oldCapacity);
+        chunk->lines = GROW_CHUNK_ARRAY(
+            LineStart,
             chunk->lines,
             oldCapacity,
-            chunk->capacity);
+            chunk->lineCapacity);
     }
 
-    // Store the byte and its line information
-    chunk->code[chunk->count] = byte;
-    chunk->lines[chunk->count] = line;
-    chunk->count++;
+    LineStart* lineStart = &chunk->lines[chunk->lineCount++];
+    lineStart->offset = chunk->count - 1;
+    lineStart->line = line;
+}
+
+/**
+ * Promotes a finished chunk out of compile-time storage.
+ *
+ * @param chunk Chunk to finalize
+ *
+ * @note Bytecode moves to the code heap, which owns it afterwards
+ * @note Lines and constants are copied into exactly sized heap arrays,
+ *       reclaiming the growth slack
+ * @note The constant dedup index is only needed while compiling
+ */
+void sealChunk(Chunk* chunk)
+{
+    if (chunk->sealed)
+        return;
+
+    uint8_t* code = chunk->count > 0 ? codeHeapStore(chunk->code, chunk->count) : NULL;
+    FREE_CHUNK_ARRAY(uint8_t, chunk->code, chunk->capacity);
+    chunk->code = code;
+    chunk->capacity = chunk->count;
+
+    chunk->lines = (LineStart*)promoteArray(chunk, chunk->lines,
+        sizeof(LineStart) * chunk->lineCount,
+        sizeof(LineStart) * chunk->lineCapacity);
+    chunk->lineCapacity = chunk->lineCount;
+
+    ValueArray* constants = &chunk->constants;
+    constants->values = (Value*)promoteArray(chunk, constants->values,
+        sizeof(Value) * constants->count,
+        sizeof(Value) * constants->capacity);
+    constants->capacity = constants->count;
+
+    FREE_CHUNK_ARRAY(int, chunk->constantIndex, chunk->indexCapacity);
+    chunk->constantIndex = NULL;
+    chunk->indexCapacity = 0;
+
+    chunk->arena = NULL;
+    chunk->sealed = true;
+}
+
+/**
+ * Discards bytecode past the given offset.
+ *
+ * @param chunk Target chunk
+ * @param count New byte count
+ *
+ * @note Drops line runs that start at or after the new end
+ */
+void truncateChunk(Chunk* chunk, int count)
+{
+    chunk->count = count;
+    while (chunk->lineCount > 0 && chunk->lines[chunk->lineCount - 1].offset >= count)
+        chunk->lineCount--;
+}
+
+/**
+ * Finds the source line for a bytecode offset.
+ *
+ * @param chunk Chunk to search
+ * @param offset Byte offset of the instruction
+ * @return Line of the run containing the offset
+ *
+ * @note Binary search for the last run starting at or before offset
+ */
+int getLine(Chunk* chunk, int offset)
+{
+    int low = 0;
+    int high = chunk->lineCount - 1;
+
+    while (low < high) {
+        int mid = low + (high - low + 1) / 2;
+        if (chunk->lines[mid].offset <= offset) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    return chunk->lineCount > 0 ? chunk->lines[low].line : 0;
 }
 
 /**
@@ -62,37 +206,157 @@ void writeChunk(Chunk* chunk, uint8_t byte, int line)
  *
  * @param chunk Chunk to deallocate
  *
- * @note Frees both bytecode and line number arrays
+ * @note Frees both bytecode and line run arrays
  * @note Also frees the constant pool
  * @note Leaves the chunk in valid empty state (can be reused)
  */
 void freeChunk(Chunk* chunk)
 {
-    // Free the bytecode storage
-    FREE_ARRAY(uint8_t, chunk->code, chunk->capacity);
+    // Arrays still in a compile arena are released with the arena
+    if (chunk->arena != NULL) {
+        initChunk(chunk);
+        return;
+    }
+
+    // Free the bytecode storage (sealed code belongs to the code heap)
+    if (!chunk->sealed)
+        FREE_ARRAY(uint8_t, chunk->code, chunk->capacity);
 
     // Free the line information storage
-    FREE_ARRAY(int, chunk->lines, chunk->capacity);
+    FREE_ARRAY(LineStart, chunk->lines, chunk->lineCapacity);
 
-    // Free the constant pool
+    // Free the constant pool and its dedup index
     freeValueArray(&chunk->constants);
+    FREE_ARRAY(int, chunk->constantIndex, chunk->indexCapacity);
 
     // Reset to initial empty state
     initChunk(chunk);
 }
 
+/**
+ * Tests whether two constants are the same value for deduplication.
+ *
+ * @note Numbers compare by bit pattern so 0 and -0 stay distinct
+ * @note Objects compare by identity (strings are interned)
+ */
+static bool sameConstant(Value a, Value b)
+{
+    if (a.type != b.type)
+        return false;
+
+    switch (a.type) {
+    case VAL_BOOL:
+        return AS_BOOL(a) == AS_BOOL(b);
+    case VAL_NIL:
+        return true;
+    case VAL_NUMBER: {
+        double x = AS_NUMBER(a);
+        double y = AS_NUMBER(b);
+        return memcmp(&x, &y, sizeof(double)) == 0;
+    }
+    case VAL_OBJ:
+        return AS_OBJ(a) == AS_OBJ(b);
+    }
+    return false;
+}
+
+/**
+ * Hashes a constant by identity, consistent with sameConstant().
+ */
+static uint32_t hashConstant(Value value)
+{
+    uint64_t bits = 0;
+    switch (value.type) {
+    case VAL_BOOL:
+        bits = AS_BOOL(value) ? 1 : 0;
+        break;
+    case VAL_NIL:
+        break;
+    case VAL_NUMBER: {
+        double number = AS_NUMBER(value);
+        memcpy(&bits, &number, sizeof(double));
+        break;
+    }
+    case VAL_OBJ:
+        bits = (uint64_t)(uintptr_t)AS_OBJ(value);
+        break;
+    }
+
+    // Mix the type tag in, then fold the 64 bits down (Fibonacci hashing)
+    bits ^= (uint64_t)value.type << 60;
+    bits *= 0x9e3779b97f4a7c15ull;
+    return (uint32_t)(bits >> 32);
+}
+
+/**
+ * Finds the index slot for a value, or the empty slot where it belongs.
+ */
+static int* findConstantSlot(int* index, int capacity, Value* constants, Value value)
+{
+    uint32_t slot = hashConstant(value) & (capacity - 1);
+    for (;;) {
+        int* entry = &index[slot];
+        if (*entry == -1 || sameConstant(constants[*entry], value))
+            return entry;
+        slot = (slot + 1) & (capacity - 1);
+    }
+}
+
+/**
+ * Rebuilds the dedup index with a larger capacity.
+ */
+static void growConstantIndex(Chunk* chunk)
+{
+    int capacity = GROW_CAPACITY(chunk->indexCapacity);
+    int* index = GROW_CHUNK_ARRAY(int, NULL, 0, capacity);
+    for (int i = 0; i < capacity; i++)
+        index[i] = -1;
+
+    for (int i = 0; i < chunk->constants.count; i++) {
+        int* slot = findConstantSlot(index, capacity, chunk->constants.values,
+            chunk->constants.values[i]);
+        *slot = i;
+    }
+
+    FREE_CHUNK_ARRAY(int, chunk->constantIndex, chunk->indexCapacity);
+    chunk->constantIndex = index;
+    chunk->indexCapacity = capacity;
+}
+
 /**
  * Adds a constant value to the chunk's constant pool.
  *
  * @param chunk Target chunk
  * @param value The value to add to the constant pool
- * @return Index of the newly added constant
+ * @return Index of the constant (existing one if already present)
  *
  * @note Constants are stored in a ValueArray within the chunk
  * @note Returned index is used by OP_CONSTANT instructions
+ * @note A hash index keeps lookups O(1); it is kept under 50% load
  */
 int addConstant(Chunk* chunk, Value value)
 {
-    writeValueArray(&chunk->constants, value);
-    return chunk->constants.count - 1; // Return new constant's index
-}
\ No newline at end of file
+    if ((chunk->constants.count + 1) * 2 > chunk->indexCapacity)
+        growConstantIndex(chunk);
+
+    int* slot = findConstantSlot(chunk->constantIndex, chunk->indexCapacity,
+        chunk->constants.values, value);
+    if (*slot != -1)
+        return *slot; // Reuse the existing constant
+
+    // Append to the pool (grown like the other chunk arrays)
+    ValueArray* constants = &chunk->constants;
+    if (constants->capacity < constants->count + 1) {
+        int oldCapacity = constants->capacity;
+        constants->capacity = GROW_CAPACITY(oldCapacity);
+        constants->values = GROW_CHUNK_ARRAY(
+            Value,
+            constants->values,
+            oldCapacity,
+            constants->capacity);
+    }
+    constants->values[constants->count++] = value;
+
+    *slot = constants->count - 1;
+    return *slot; // Return new constant's index
+}
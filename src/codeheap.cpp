@@ -0,0 +1,121 @@
+#include <cstring>    // For memcpy
+#include <iostream>   // For error output
+#include <mutex>      // For stores from parallel module compiles
+#include <sys/mman.h> // For mmap, mprotect, munmap
+#include <unistd.h>   // For sysconf
+
+#include "codeheap.h" // For code heap interface
+#include "memory.h"   // For ALLOCATE and FREE
+
+// Minimum size of a code heap block (rounded up to whole pages)
+#define CODE_BLOCK_MIN (64 * 1024)
+
+/**
+ * One mapping of the code heap. Blocks are filled in order and never
+ * reused, so earlier functions stay where they were placed.
+ */
+typedef struct CodeBlock {
+    struct CodeBlock* next; // Previously filled block
+    uint8_t* base;          // Start of the mapping
+    size_t size;            // Mapping size in bytes (whole pages)
+    size_t used;            // Bytes handed out so far
+    bool sealed;            // Whether the mapping is currently read-only
+} CodeBlock;
+
+// Block currently being filled; older blocks hang off its next pointer
+static CodeBlock* codeHeap = NULL;
+
+// Serializes codeHeapStore() between threads compiling modules in parallel
+static std::mutex codeHeapLock;
+
+/**
+ * Changes the protection of a block, exiting if the kernel refuses.
+ */
+static void protectBlock(CodeBlock* block, bool sealed)
+{
+    int protection = sealed ? PROT_READ : PROT_READ | PROT_WRITE;
+    if (mprotect(block->base, block->size, protection) != 0) {
+        std::cerr << "[Delirium] Could not change code heap protection" << std::endl;
+        exit(1);
+    }
+    block->sealed = sealed;
+}
+
+/**
+ * Maps a new block large enough for `count` bytes and makes it current.
+ */
+static CodeBlock* newBlock(size_t count)
+{
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = count > CODE_BLOCK_MIN ? count : CODE_BLOCK_MIN;
+    size = (size + pageSize - 1) / pageSize * pageSize;
+
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        std::cerr << "[Delirium] Memory allocation failed" << std::endl;
+        exit(1);
+    }
+
+    CodeBlock* block = ALLOCATE(CodeBlock, 1);
+    block->next = codeHeap;
+    block->base = (uint8_t*)base;
+    block->size = size;
+    block->used = 0;
+    block->sealed = false;
+    codeHeap = block;
+    return block;
+}
+
+/**
+ * Copies finished bytecode into the code heap.
+ *
+ * @param code Bytecode to copy
+ * @param count Number of bytes
+ * @return Address of the copy
+ *
+ * @note Reopens the current block for writing if it was sealed
+ * @note Safe to call from several threads at once
+ */
+uint8_t* codeHeapStore(uint8_t const* code, int count)
+{
+    std::lock_guard<std::mutex> guard(codeHeapLock);
+
+    CodeBlock* block = codeHeap;
+    if (block == NULL || block->size - block->used < (size_t)count) {
+        block = newBlock((size_t)count);
+    } else if (block->sealed) {
+        protectBlock(block, false);
+    }
+
+    uint8_t* destination = block->base + block->used;
+    memcpy(destination, code, count);
+    block->used += count;
+    return destination;
+}
+
+/**
+ * Maps all code heap blocks read-only.
+ */
+void sealCodeHeap()
+{
+    for (CodeBlock* block = codeHeap; block != NULL; block = block->next) {
+        if (!block->sealed)
+            protectBlock(block, true);
+    }
+}
+
+/**
+ * Unmaps all code heap blocks.
+ */
+void freeCodeHeap()
+{
+    CodeBlock* block = codeHeap;
+    while (block != NULL) {
+        CodeBlock* next = block->next;
+        munmap(block->base, block->size);
+        FREE(CodeBlock, block);
+        block = next;
+    }
+    codeHeap = NULL;
+}
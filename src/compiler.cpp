@@ -1,3 +1,5 @@
+#include <cctype>
+#include <charconv>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
@@ -5,12 +7,19 @@
 
 #include <algorithm>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include "arena.h"
 #include "chunk.h"
+#include "codeheap.h"
 #include "common.h"
 #include "compiler.h"
 #include "debug.h"
 #include "lexer.h"
+#include "module.h"
 #include "mutator.h"
 #include "object.h"
 #include "value.h"
@@ -21,7 +30,7 @@
 #endif
 
 /* ==================================================================== */
-bool canMutate = true; // Mutation is run when true
+thread_local bool canMutate = true; // Mutation is run when true
 
 /* ====================== Parser Types and State ====================== */
 
@@ -50,8 +59,12 @@ typedef enum Precedence {
 typedef struct Parser {
     Token current;  // Current token being processed
     Token previous; // Previous token processed
-    bool hadError;  // Whether an error occurred
-    bool panicMode; // Whether we're in error recovery mode
+    bool hadError;       // Whether an error occurred
+    bool panicMode;      // Whether we're in error recovery mode
+    bool stringOperand;  // Whether the last operand is known to be a string
+    TokenStream* tokens; // Pre-lexed tokens (NULL to pull from scanToken())
+    int nextToken;       // Index of the next token in `tokens`
+    int lineCursor;      // Line index position for streamToken()
 } Parser;
 
 /* Function pointer type for parse rules */
@@ -95,13 +108,65 @@ typedef struct Compiler {
     int scopeDepth;             // Current block nesting depth
 } Compiler;
 
+/**
+ * State of the file being compiled: the main script or an imported
+ * module. Set aside while an import compiles another file.
+ */
+typedef struct CompilationUnit {
+    std::string path;     // Path of the file ("-" for standard input)
+    ObjString* module;    // Namespace of a module, NULL for the main script
+    ModuleSource* source; // Cache entry of a module, NULL for the main script
+    Table declared;       // Top-level globals of a module: name -> qualified name
+    Table imports;        // Modules imported so far: namespace -> ObjModule
+    uint64_t importHash;  // Hash of the imported namespaces, in import order
+    bool lazy;            // Whether function bodies may be compiled lazily
+    bool parallel;        // Compiled by precompileModules(): errors are only recorded
+} CompilationUnit;
+
 /* ====================== Global Variables ====================== */
 
-/* Global parser state */
-Parser parser;
+// The compilation state is per thread: precompileModules() compiles
+// modules on worker threads while the main thread waits.
+
+/* Parser state */
+thread_local Parser parser;
+
+/* Compiler state */
+thread_local Compiler* current = NULL;
+
+/* Transient compile-time storage, released when a compilation ends */
+static thread_local Arena compilerArena;
+
+/* File being compiled (NULL outside compile()) */
+static thread_local CompilationUnit* unit = NULL;
+
+/* Tokens of the script being compiled */
+static TokenStream scriptTokens;
+
+/**
+ * A top-level function of the main script kept between compiles.
+ */
+typedef struct CachedFunction {
+    ObjFunction* function; // Compiled function (stays on the VM's object list)
+    std::string body;      // Text of its body span
+    int newlines;          // Line breaks inside the body span
+    uint64_t imports;      // importHash of the script before it
+} CachedFunction;
+
+/**
+ * Top-level functions of the last successful compile, reused by the next
+ * one when their source is unchanged (see enableFunctionCache()).
+ */
+typedef struct FunctionCache {
+    bool enabled;                                           // Set by enableFunctionCache()
+    std::unordered_map<uint64_t, CachedFunction> functions; // By span hash
+    std::unordered_multimap<std::string, uint64_t> names;   // Span hashes by function name
+    std::unordered_map<uint64_t, CachedFunction> seen;      // Functions of the compile in progress
+    char const* end;                                        // End of the source being compiled
+    RecompileStats stats;                                   // Counts for the compile in progress
+} FunctionCache;
 
-/* Global compiler state */
-Compiler* current = NULL;
+static FunctionCache functionCache;
 
 /* Current chunk being compiled */
 /* Chunk* compilingChunk; */ // Potential Error
@@ -123,26 +188,42 @@ static Chunk* currentChunk()
  */
 static void errorAt(Token* token, char const* message)
 {
-#ifdef DEBUG_MUTATE_CODE
-    if (canMutate) {
-        char const* lex = getLexer();
-        Mutator mut = Mutator(lex, sourcePath);
-        mut.mutateCode();
-        canMutate = false;
+    if (parser.panicMode)
+        return;
+    if (unit != NULL && unit->parallel) {
+        // The main thread compiles the module again to report the error
+        parser.panicMode = true;
+        parser.hadError = true;
+        return;
     }
+#ifdef DEBUG_MUTATE_CODE
+    if (vm.mutateOnError) {
+        if (canMutate) {
+            flushOutput(&vm.output); // The mutator prints straight to std::cout
+            char const* lex = getLexer();
+            Mutator mut = Mutator(lex, sourcePath);
+            mut.mutateCode();
+            canMutate = false;
+        }
+
+        parser.panicMode = true;
+        parser.hadError = true;
 
-    if (parser.panicMode)
         return;
+    }
+#endif
+
     parser.panicMode = true;
     parser.hadError = true;
 
-    return;
-#endif
-
-    std::cerr << "[line " << token->line << "] Error";
+    flushOutput(&vm.output); // Lazy compiles happen after the script printed
+    if (unit != NULL && unit->module != NULL)
+        std::cerr << "[line " << token->line << " of " << unit->path << "] Error";
+    else
+        std::cerr << "[line " << token->line << "] Error";
 
     if (token->type == TOKEN_EOF) {
-        std::cout << " at end";
+        std::cerr << " at end";
     } else if (token->type == TOKEN_ERROR) {
         // Nothing
     } else {
@@ -170,6 +251,21 @@ static void errorAtCurrent(char const* message)
 
 /* ====================== Token Processing ====================== */
 
+/**
+ * Returns the next token, from the token stream if there is one.
+ */
+static Token nextToken()
+{
+    if (parser.tokens == NULL)
+        return scanToken();
+
+    // TOKEN_EOF is the last entry; keep returning it past the end
+    int index = parser.nextToken;
+    if (index < parser.tokens->count - 1)
+        parser.nextToken++;
+    return streamToken(parser.tokens, index, &parser.lineCursor);
+}
+
 /**
  * Advances the lexer to the next token, skipping any invalid tokens.
  * Updates `parser.previous` with the last valid token.
@@ -179,7 +275,7 @@ static void advance()
     parser.previous = parser.current; // Store the previous token.
 
     for (;;) {                        // Keep advancing until a valid token is found.
-        parser.current = scanToken(); // Fetch the next token from the source.
+        parser.current = nextToken(); // Fetch the next token from the source.
 
         if (parser.current.type != TOKEN_ERROR) {
             break; // Stop if it's a valid token.
@@ -281,17 +377,39 @@ static void emitReturn()
 
 /**
  * Creates a constant value in the constant pool.
+ * Identical constants share a single pool entry.
  * @return The constant index or 0 if too many constants exist.
  */
-static uint8_t makeConstant(Value value)
+static int makeConstant(Value value)
 {
     int constant = addConstant(currentChunk(), value);
-    if (constant > UINT8_MAX) {
+    if (constant > CONSTANT_LONG_MAX) {
         error("Too many constants in one chunk");
         return 0;
     }
 
-    return (uint8_t)constant;
+    return constant;
+}
+
+/**
+ * Emits an instruction whose operand is a constant pool index, choosing
+ * the 24-bit long form when the index does not fit in a byte.
+ *
+ * @param op Opcode taking a 1-byte index.
+ * @param longOp Equivalent opcode taking a 3-byte index.
+ * @param index Constant pool index.
+ */
+static void emitConstantOp(uint8_t op, uint8_t longOp, int index)
+{
+    if (index <= UINT8_MAX) {
+        emitBytes(op, (uint8_t)index);
+        return;
+    }
+
+    emitByte(longOp);
+    emitByte((index >> 16) & 0xff);
+    emitByte((index >> 8) & 0xff);
+    emitByte(index & 0xff);
 }
 
 /**
@@ -301,7 +419,7 @@ static uint8_t makeConstant(Value value)
  */
 static void emitConstant(Value value)
 {
-    emitBytes(OP_CONSTANT, makeConstant(value));
+    emitConstantOp(OP_CONSTANT, OP_CONSTANT_LONG, makeConstant(value));
 }
 
 /**
@@ -322,18 +440,21 @@ static void patchJump(int offset)
 
 /**
  * Initializes a new compiler for a function.
+ *
+ * @param function Existing function to compile into, or NULL to create one
  */
-static void initCompiler(Compiler* compiler, FunctionType type)
+static void initCompiler(Compiler* compiler, FunctionType type, ObjFunction* function)
 {
     compiler->enclosing = current;
     compiler->function = NULL;
     compiler->type = type;
     compiler->localCount = 0;
     compiler->scopeDepth = 0;
-    compiler->function = newFunction();
+    compiler->function = function != NULL ? function : newFunction();
+    compiler->function->chunk.arena = &compilerArena;
     current = compiler;
 
-    if (type != TYPE_SCRIPT) {
+    if (type != TYPE_SCRIPT && function == NULL) {
         current->function->name = copyString(parser.previous.start,
             parser.previous.length);
     }
@@ -359,8 +480,22 @@ static void parsePrecedence(Precedence precedence);
  */
 static void number(bool canAssign)
 {
-    double value = strtod(parser.previous.start, NULL); // Convert token to a number.
-    emitConstant(NUMBER_VAL(value));                    // Emit the constant into the bytecode.
+    // The lexer only produces digits with an optional fraction, which
+    // from_chars parses without consulting the locale or needing a
+    // terminator after the token.
+    char const* start = parser.previous.start;
+    char const* end = start + parser.previous.length;
+    double value;
+    std::from_chars_result result = std::from_chars(start, end, value);
+    if (result.ec == std::errc::result_out_of_range) {
+        // from_chars leaves `value` untouched; strtod rounds an overflow
+        // to HUGE_VAL and an underflow toward zero, as literals always did
+        value = strtod(std::string(start, end).c_str(), NULL);
+    } else if (result.ec != std::errc() || result.ptr != end) {
+        error("Invalid number literal.");
+        return;
+    }
+    emitConstant(NUMBER_VAL(value)); // Emit the constant into the bytecode.
 }
 
 /**
@@ -397,15 +532,38 @@ static void and_(bool canAssign)
 static void string(bool canAssign)
 {
     emitConstant(OBJ_VAL(copyString(parser.previous.start + 1, parser.previous.length - 2)));
+    parser.stringOperand = true;
+}
+
+/**
+ * Builds the interned "<module>.<name>" key of a module global.
+ *
+ * @param module Namespace of the module
+ * @param chars Name of the global
+ * @param length Length of the name
+ */
+static ObjString* qualifiedName(ObjString* module, char const* chars, int length)
+{
+    std::string qualified(module->chars, module->length);
+    qualified += '.';
+    qualified.append(chars, length);
+    return copyString(qualified.data(), (int)qualified.size());
 }
 
 /**
- * Creates a constant for an identifier name.
+ * Creates a constant for the name of a global variable.
+ *
+ * Inside a module, globals the module declares at the top level are
+ * stored under their qualified name; any other name (natives, globals of
+ * the main script) is used as written.
  */
-static uint8_t identifierConstant(Token* name)
+static int globalConstant(Token* name)
 {
-    return makeConstant(OBJ_VAL(copyString(name->start,
-        name->length)));
+    ObjString* string = copyString(name->start, name->length);
+    Value qualified;
+    if (unit != NULL && unit->module != NULL && tableGet(&unit->declared, string, &qualified))
+        string = AS_STRING(qualified);
+    return makeConstant(OBJ_VAL(string));
 }
 
 /**
@@ -500,22 +658,34 @@ static uint8_t argumentList()
  */
 static void namedVariable(Token name, bool canAssign)
 {
-    uint8_t getOp, setOp;
     int arg = resolveLocal(current, &name);
     if (arg != -1) {
-        getOp = OP_GET_LOCAL;
-        setOp = OP_SET_LOCAL;
+        if (canAssign && match(TOKEN_EQUAL)) {
+            expression();
+            emitBytes(OP_SET_LOCAL, (uint8_t)arg);
+        } else {
+            emitBytes(OP_GET_LOCAL, (uint8_t)arg);
+        }
+        return;
+    }
+
+    // `module.name` refers to a global of an imported module
+    Value module;
+    if (check(TOKEN_DOT) && unit != NULL && unit->imports.count > 0
+        && tableGet(&unit->imports, copyString(name.start, name.length), &module)) {
+        advance();
+        consume(TOKEN_IDENTIFIER, "Expect name after module name.");
+        arg = makeConstant(OBJ_VAL(qualifiedName(AS_MODULE(module)->name,
+            parser.previous.start, parser.previous.length)));
     } else {
-        arg = identifierConstant(&name);
-        getOp = OP_GET_GLOBAL;
-        setOp = OP_SET_GLOBAL;
+        arg = globalConstant(&name);
     }
 
     if (canAssign && match(TOKEN_EQUAL)) {
         expression();
-        emitBytes(setOp, (uint8_t)arg);
+        emitConstantOp(OP_SET_GLOBAL, OP_SET_GLOBAL_LONG, arg);
     } else {
-        emitBytes(getOp, (uint8_t)arg);
+        emitConstantOp(OP_GET_GLOBAL, OP_GET_GLOBAL_LONG, arg);
     }
 }
 
@@ -558,6 +728,7 @@ static void unary(bool canAssign)
     default:
         return; // Should never be reached.
     }
+    parser.stringOperand = false;
 }
 
 /**
@@ -580,17 +751,55 @@ static void literal(bool canAssign)
     }
 }
 
+/**
+ * Compiles the rest of a `+` chain known to involve a string.
+ *
+ * Called with the first two operands already on the stack. Every further
+ * `+ operand` is collected, and the chain is emitted as one OP_CONCAT_N
+ * so the VM builds the result in a single pass instead of creating an
+ * intermediate string per `+`.
+ *
+ * @note The VM falls back to pairwise OP_ADD semantics when an operand
+ *       turns out not to be a string
+ */
+static void concatenation()
+{
+    int count = 2;
+    while (match(TOKEN_PLUS)) {
+        if (count == UINT8_MAX) {
+            // Fold what we have so far and keep going from its result
+            emitBytes(OP_CONCAT_N, (uint8_t)count);
+            count = 1;
+        }
+        parsePrecedence((Precedence)(PREC_TERM + 1));
+        count++;
+    }
+
+    if (count == 2)
+        emitByte(OP_ADD);
+    else
+        emitBytes(OP_CONCAT_N, (uint8_t)count);
+    parser.stringOperand = true;
+}
+
 /**
  * Parses a binary operator (e.g., `+`, `-`, `*`, `/`) and its right-hand side expression.
  */
 static void binary(bool canAssign)
 {
     TokenType operatorType = parser.previous.type; // Get the operator token.
+    bool leftString = parser.stringOperand;
 
     // Get the precedence level for the operator and parse the right-hand side.
     Precedence nextPrecedence = (Precedence)(getRule(operatorType)->precedence + 1);
     parsePrecedence(nextPrecedence); // Ensure correct precedence order.
 
+    if (operatorType == TOKEN_PLUS && (leftString || parser.stringOperand)) {
+        concatenation();
+        return;
+    }
+    parser.stringOperand = false;
+
     // Generate bytecode for the operator.
     switch (operatorType) {
     case TOKEN_BANG_EQUAL:
@@ -666,12 +875,17 @@ ParseRule rules[] = {
     [TOKEN_STRING] = { string, NULL, PREC_NONE },
     [TOKEN_NUMBER] = { number, NULL, PREC_NONE },
     [TOKEN_AND] = { NULL, and_, PREC_AND },
+    [TOKEN_BREAK] = { NULL, NULL, PREC_NONE },
     [TOKEN_CLASS] = { NULL, NULL, PREC_NONE },
+    [TOKEN_CONTINUE] = { NULL, NULL, PREC_NONE },
+    [TOKEN_DO] = { NULL, NULL, PREC_NONE },
     [TOKEN_ELSE] = { literal, NULL, PREC_NONE },
+    [TOKEN_ELSEIF] = { NULL, NULL, PREC_NONE },
     [TOKEN_FALSE] = { NULL, NULL, PREC_NONE },
     [TOKEN_FOR] = { NULL, NULL, PREC_NONE },
     [TOKEN_FUN] = { NULL, NULL, PREC_NONE },
     [TOKEN_IF] = { NULL, NULL, PREC_NONE },
+    [TOKEN_IMPORT] = { NULL, NULL, PREC_NONE },
     [TOKEN_NIL] = { literal, NULL, PREC_NONE },
     [TOKEN_OR] = { NULL, or_, PREC_OR },
     [TOKEN_PRINT] = { NULL, NULL, PREC_NONE },
@@ -704,7 +918,7 @@ static ObjFunction* endCompiler();
 /**
  * Parses a variable declaration.
  */
-static uint8_t parseVariable(char const* errorMessage)
+static int parseVariable(char const* errorMessage)
 {
     consume(TOKEN_IDENTIFIER, errorMessage);
 
@@ -712,7 +926,7 @@ static uint8_t parseVariable(char const* errorMessage)
     if (current->scopeDepth > 0)
         return 0;
 
-    return identifierConstant(&parser.previous);
+    return globalConstant(&parser.previous);
 }
 
 /**
@@ -728,13 +942,13 @@ static void markInitialized()
 /**
  * Defines a variable in the current scope.
  */
-static void defineVariable(uint8_t global)
+static void defineVariable(int global)
 {
     if (current->scopeDepth > 0) {
         markInitialized();
         return;
     }
-    emitBytes(OP_DEFINE_GLOBAL, global);
+    emitConstantOp(OP_DEFINE_GLOBAL, OP_DEFINE_GLOBAL_LONG, global);
 }
 
 /**
@@ -755,6 +969,7 @@ static void parsePrecedence(Precedence precedence)
 
     // prefixRule(); // Call the prefix function (e.g., number() for literals).
     bool canAssign = precedence <= PREC_ASSIGNMENT;
+    parser.stringOperand = false; // Only string literals and concatenations set it
     prefixRule(canAssign);
 
     // Continue parsing while the next operator has equal or higher precedence.
@@ -762,6 +977,8 @@ static void parsePrecedence(Precedence precedence)
         advance();                                                // Move to the next token.
         ParseFn infixRule = getRule(parser.previous.type)->infix; // Get infix rule.
         infixRule(canAssign);                                     // Call the infix function (e.g., binary() for `+`, `*`).
+        if (infixRule != binary)
+            parser.stringOperand = false; // Calls and logical operators yield unknown types
     }
 
     if (canAssign && match(TOKEN_EQUAL)) {
@@ -816,12 +1033,10 @@ static void block()
 }
 
 /**
- * Parses a function declaration.
+ * Parses a function's parameter list and body into the current compiler.
  */
-static void function(FunctionType type)
+static void functionBody()
 {
-    Compiler compiler;
-    initCompiler(&compiler, type);
     beginScope();
 
     consume(TOKEN_LEFT_PAREN, "Expect '(' after function name.");
@@ -832,7 +1047,7 @@ static void function(FunctionType type)
             if (current->function->arity > 255) {
                 errorAtCurrent("Can't have more than 255 parameters.");
             }
-            uint8_t constant = parseVariable("Expect parameter name.");
+            int constant = parseVariable("Expect parameter name.");
             defineVariable(constant);
         } while (match(TOKEN_COMMA));
     }
@@ -840,9 +1055,258 @@ static void function(FunctionType type)
     consume(TOKEN_RIGHT_PAREN, "Expect ')' after parameters.");
     consume(TOKEN_LEFT_BRACE, "Expect '{' before function body.");
     block();
+}
+
+#ifdef LAZY_COMPILE
+/**
+ * Scans over a function's parameters and body without compiling them.
+ * Returns a stub that records the arity and the source span of the
+ * body; compileFunction() fills in its chunk on the first call.
+ */
+static ObjFunction* skipFunction()
+{
+    ObjFunction* function = newFunction();
+    function->name = copyString(parser.previous.start, parser.previous.length);
+    function->compiled = false;
+    function->body.start = parser.current.start;
+    function->body.line = parser.current.line;
+
+    consume(TOKEN_LEFT_PAREN, "Expect '(' after function name.");
+
+    if (!check(TOKEN_RIGHT_PAREN)) {
+        do {
+            function->arity++;
+            if (function->arity > 255) {
+                errorAtCurrent("Can't have more than 255 parameters.");
+            }
+            consume(TOKEN_IDENTIFIER, "Expect parameter name.");
+        } while (match(TOKEN_COMMA));
+    }
+
+    consume(TOKEN_RIGHT_PAREN, "Expect ')' after parameters.");
+    consume(TOKEN_LEFT_BRACE, "Expect '{' before function body.");
+
+    // Only braces matter while skipping; the body is parsed on first call.
+    int depth = 1;
+    while (depth > 0 && !check(TOKEN_EOF)) {
+        if (check(TOKEN_LEFT_BRACE)) {
+            depth++;
+        } else if (check(TOKEN_RIGHT_BRACE)) {
+            depth--;
+        }
+        advance();
+    }
+
+    if (depth > 0)
+        errorAtCurrent("Expect '}' after block.");
+
+    function->body.length = (int)(parser.previous.start + parser.previous.length - function->body.start);
+    return function;
+}
+#endif
+
+/* ====================== Incremental Recompilation ====================== */
+
+/**
+ * Hashes a function's name together with its body span.
+ */
+static uint64_t spanHash(char const* name, int nameLength, char const* span, int length)
+{
+    std::hash<std::string_view> hash;
+    return hash(std::string_view(span, length))
+        ^ (hash(std::string_view(name, nameLength)) * 0x9e3779b97f4a7c15ull);
+}
+
+/**
+ * Prepares the function cache for compiling a new version of the script.
+ */
+static void beginFunctionCache(char const* source, size_t length)
+{
+    functionCache.seen.clear();
+    functionCache.end = source + length;
+    functionCache.stats.reused = 0;
+    functionCache.stats.compiled = 0;
+}
+
+/**
+ * Keeps the functions of a successful compile for the next one.
+ */
+static void endFunctionCache(bool success)
+{
+    FunctionCache* cache = &functionCache;
+    if (cache->enabled && success) {
+        cache->functions.swap(cache->seen);
+        cache->names.clear();
+        for (auto const& [hash, entry] : cache->functions) {
+            ObjString* name = entry.function->name;
+            cache->names.emplace(std::string(name->chars, name->length), hash);
+        }
+    }
+    cache->seen.clear();
+}
+
+/**
+ * Whether the function about to be declared is one the cache tracks: a
+ * top-level function of the main script. Its code then depends only on
+ * its own text and the modules imported before it.
+ */
+static bool cacheableFunction()
+{
+    return functionCache.enabled && unit != NULL && unit->module == NULL
+        && current->type == TYPE_SCRIPT && current->scopeDepth == 0;
+}
+
+/**
+ * Records a freshly compiled (or scanned) top-level function.
+ */
+static void rememberFunction(ObjFunction* function)
+{
+    CachedFunction entry;
+    entry.function = function;
+    entry.body.assign(function->body.start, function->body.length);
+    entry.newlines = (int)std::count(entry.body.begin(), entry.body.end(), '\n');
+    entry.imports = unit->importHash;
+
+    uint64_t hash = spanHash(function->name->chars, function->name->length,
+        function->body.start, function->body.length);
+    functionCache.seen.emplace(hash, entry); // A duplicate stays uncached
+    functionCache.stats.compiled++;
+}
+
+/**
+ * Moves a reused function (and the functions nested in it) to its span in
+ * the new source, shifting its line numbers by the lines added or removed
+ * above it.
+ *
+ * @param function Function to move
+ * @param start New position of its body span
+ * @param lineDelta Line shift
+ */
+static void relocateFunction(ObjFunction* function, char const* start, int lineDelta)
+{
+    Chunk* chunk = &function->chunk;
+    for (int i = 0; i < chunk->constants.count; i++) {
+        Value constant = chunk->constants.values[i];
+        if (IS_FUNCTION(constant)) {
+            ObjFunction* nested = AS_FUNCTION(constant);
+            relocateFunction(nested, start + (nested->body.start - function->body.start), lineDelta);
+        }
+    }
+
+    if (lineDelta != 0) {
+        for (int i = 0; i < chunk->lineCount; i++)
+            chunk->lines[i].line += lineDelta;
+    }
+    function->body.start = start;
+    function->body.line += lineDelta;
+}
+
+/**
+ * Reuses the cached function for the declaration being compiled, if one
+ * with the same name has exactly the same body.
+ *
+ * Each cached function with this name says how long its body span was;
+ * hashing that many bytes from the '(' finds the candidate whose body is
+ * unchanged, wherever it moved, and comparing the text confirms it. The
+ * script must also have imported the same namespaces in the same order,
+ * since they decide how `module.name` in the body compiled. The body is
+ * then not lexed: parsing resumes at its closing brace, as if function()
+ * had just compiled it.
+ *
+ * @return true if a cached function was emitted
+ */
+static bool reuseFunction()
+{
+    FunctionCache* cache = &functionCache;
+    auto candidates = cache->names.equal_range(
+        std::string(parser.previous.start, parser.previous.length));
+
+    for (auto candidate = candidates.first; candidate != candidates.second; candidate++) {
+        uint64_t hash = candidate->second;
+        CachedFunction const& entry = cache->functions.at(hash);
+        int length = (int)entry.body.size();
+        if (length > cache->end - parser.current.start
+            || entry.imports != unit->importHash || cache->seen.count(hash) != 0
+            || spanHash(parser.previous.start, parser.previous.length,
+                   parser.current.start, length) != hash
+            || memcmp(parser.current.start, entry.body.data(), length) != 0)
+            continue;
+
+        int line = parser.current.line;
+        char const* close = parser.current.start + length - 1;
+        relocateFunction(entry.function, parser.current.start, line - entry.function->body.line);
+
+        // Resume at the closing brace: '(' becomes previous, '}' current,
+        // then one more advance() leaves the parser just past the body
+        if (parser.tokens == NULL) {
+            resetLexer(close, line + entry.newlines);
+        } else {
+            uint32_t* offsets = parser.tokens->offsets;
+            uint32_t target = (uint32_t)(close - parser.tokens->source);
+            parser.nextToken = (int)(std::lower_bound(offsets + parser.nextToken,
+                                         offsets + parser.tokens->count, target)
+                - offsets);
+        }
+        advance();
+        advance();
+
+        emitConstant(OBJ_VAL(entry.function));
+        cache->seen.emplace(hash, entry);
+        cache->stats.reused++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Keeps compiled top-level functions between compile() calls.
+ */
+void enableFunctionCache()
+{
+    functionCache.enabled = true;
+}
+
+/**
+ * Returns how many top-level functions the last compile() reused.
+ */
+RecompileStats functionCacheStats()
+{
+    return functionCache.stats;
+}
+
+/**
+ * Parses a function declaration.
+ */
+static void function(FunctionType type)
+{
+    bool cacheable = cacheableFunction();
+    if (cacheable && reuseFunction())
+        return;
+
+#ifdef LAZY_COMPILE
+    if (unit == NULL || unit->lazy) {
+        ObjFunction* stub = skipFunction();
+        if (cacheable)
+            rememberFunction(stub);
+        emitConstant(OBJ_VAL(stub));
+        return;
+    }
+#endif
+
+    Compiler* compiler = ARENA_ALLOCATE(&compilerArena, Compiler, 1);
+    initCompiler(compiler, type, NULL);
+
+    char const* bodyStart = parser.current.start;
+    int bodyLine = parser.current.line;
+    functionBody();
 
     ObjFunction* function = endCompiler();
-    emitBytes(OP_CONSTANT, makeConstant(OBJ_VAL(function)));
+    function->body.start = bodyStart;
+    function->body.length = (int)(parser.previous.start + parser.previous.length - bodyStart);
+    function->body.line = bodyLine;
+    if (cacheable)
+        rememberFunction(function);
+    emitConstant(OBJ_VAL(function));
 }
 
 /**
@@ -850,7 +1314,7 @@ static void function(FunctionType type)
  */
 static void funDeclaration()
 {
-    uint8_t global = parseVariable("Expect function name");
+    int global = parseVariable("Expect function name");
     markInitialized();
     function(TYPE_FUNCTION);
     defineVariable(global);
@@ -861,7 +1325,7 @@ static void funDeclaration()
  */
 static void varDeclaration()
 {
-    uint8_t global = parseVariable("Expect variable name.");
+    int global = parseVariable("Expect variable name.");
 
     if (match(TOKEN_EQUAL)) {
         expression();
@@ -884,6 +1348,124 @@ static void expressionStatement()
     emitByte(OP_POP);
 }
 
+/**
+ * Operands of a counted loop recognised by matchCountedLoop().
+ */
+typedef struct CountedLoop {
+    uint8_t slot;  // Local slot of the induction variable
+    uint8_t step;  // Constant index of the per-iteration step
+    uint8_t mode;  // Comparison and limit source (see FOR_STEP_MODE)
+    uint8_t limit; // Limit operand (slot or constant index)
+} CountedLoop;
+
+/**
+ * Checks whether the bytecode just emitted for a for loop's condition and
+ * increment clauses describes a counted loop:
+ *
+ *   condition: OP_GET_LOCAL x, <local|constant|global limit>, OP_LESS|OP_GREATER [OP_NOT]
+ *   increment: OP_GET_LOCAL x, OP_CONSTANT step, OP_ADD|OP_SUBTRACT, OP_SET_LOCAL x
+ *
+ * The step must be a number literal. Matching on emitted code rather than
+ * on tokens keeps the single-pass parser unchanged.
+ */
+static bool matchCountedLoop(int conditionStart, int conditionEnd,
+    int incrementStart, int incrementEnd, CountedLoop* loop)
+{
+    uint8_t* code = currentChunk()->code;
+    Value* constants = currentChunk()->constants.values;
+
+    uint8_t* increment = &code[incrementStart];
+    if (incrementEnd - incrementStart != 7 || increment[0] != OP_GET_LOCAL
+        || increment[2] != OP_CONSTANT || increment[5] != OP_SET_LOCAL
+        || increment[6] != increment[1]) {
+        return false;
+    }
+    if (increment[4] != OP_ADD && increment[4] != OP_SUBTRACT)
+        return false;
+
+    Value step = constants[increment[3]];
+    if (!IS_NUMBER(step))
+        return false;
+
+    uint8_t* condition = &code[conditionStart];
+    int conditionLength = conditionEnd - conditionStart;
+    if (conditionLength != 5 && conditionLength != 6)
+        return false;
+    if (condition[0] != OP_GET_LOCAL || condition[1] != increment[1])
+        return false;
+
+    ForStepLimit limit;
+    switch (condition[2]) {
+    case OP_GET_LOCAL:
+        limit = FOR_LIMIT_LOCAL;
+        break;
+    case OP_CONSTANT:
+        limit = FOR_LIMIT_CONSTANT;
+        break;
+    case OP_GET_GLOBAL:
+        limit = FOR_LIMIT_GLOBAL;
+        break;
+    default:
+        return false;
+    }
+
+    bool negated = conditionLength == 6;
+    if (negated && condition[5] != OP_NOT)
+        return false;
+
+    ForStepCompare compare;
+    if (condition[4] == OP_LESS) {
+        compare = negated ? FOR_CMP_NOT_LESS : FOR_CMP_LESS;
+    } else if (condition[4] == OP_GREATER) {
+        compare = negated ? FOR_CMP_NOT_GREATER : FOR_CMP_GREATER;
+    } else {
+        return false;
+    }
+
+    loop->slot = increment[1];
+    loop->mode = FOR_STEP_MODE(compare, limit);
+    loop->limit = condition[3];
+
+    // x - c is exactly x + (-c), so a single additive step covers both.
+    if (increment[4] == OP_SUBTRACT) {
+        int negated = makeConstant(NUMBER_VAL(-AS_NUMBER(step)));
+        if (negated > UINT8_MAX)
+            return false;
+        loop->step = (uint8_t)negated;
+    } else {
+        loop->step = increment[3];
+    }
+    return true;
+}
+
+/**
+ * Compiles the body of a counted loop and closes it with OP_FOR_STEP,
+ * which folds the increment, the condition and the backward jump into one
+ * dispatch. The condition emitted before the body is kept as the entry check.
+ */
+static void countedLoopBody(CountedLoop* loop, int exitJump)
+{
+    int bodyStart = currentChunk()->count;
+    statement();
+
+    emitBytes(OP_FOR_STEP, loop->slot);
+    emitBytes(loop->step, loop->mode);
+    emitByte(loop->limit);
+
+    int offset = currentChunk()->count - bodyStart + 2;
+    if (offset > UINT16_MAX)
+        error("Loop body too large.");
+
+    emitByte((offset >> 8) & 0xff);
+    emitByte(offset & 0xff);
+
+    // Falling out of OP_FOR_STEP leaves no condition on the stack.
+    int endJump = emitJump(OP_JUMP);
+    patchJump(exitJump);
+    emitByte(OP_POP); // Condition.
+    patchJump(endJump);
+}
+
 /**
  * Parses a for loop statement.
  */
@@ -902,11 +1484,13 @@ static void forStatement()
     }
 
     int loopStart = currentChunk()->count;
+    int conditionEnd = loopStart;
     int exitJump = -1;
 
     if (!match(TOKEN_SEMICOLON)) {
         expression();
         consume(TOKEN_SEMICOLON, "Expect ';' after loop condition.");
+        conditionEnd = currentChunk()->count;
 
         // Jump out of the loop if the condition is false.
         exitJump = emitJump(OP_JUMP_IF_FALSE);
@@ -917,9 +1501,20 @@ static void forStatement()
         int bodyJump = emitJump(OP_JUMP);
         int incrementStart = currentChunk()->count;
         expression();
+        int incrementEnd = currentChunk()->count;
         emitByte(OP_POP);
         consume(TOKEN_RIGHT_PAREN, "Expect ')' after for clauses.");
 
+        CountedLoop counted;
+        if (exitJump != -1 && !parser.hadError
+            && matchCountedLoop(loopStart, conditionEnd, incrementStart, incrementEnd, &counted)) {
+            // Drop the generic increment block; OP_FOR_STEP replaces it.
+            truncateChunk(currentChunk(), bodyJump - 1);
+            countedLoopBody(&counted, exitJump);
+            endScope();
+            return;
+        }
+
         emitLoop(loopStart);
         loopStart = incrementStart;
         patchJump(bodyJump);
@@ -954,7 +1549,9 @@ static void ifStatement()
     patchJump(thenJump);
     emitByte(OP_POP); // Could be error
 
-    if (match(TOKEN_ELSE))
+    if (match(TOKEN_ELSEIF))
+        ifStatement(); // `elseif (c) s` is `else if (c) s`
+    else if (match(TOKEN_ELSE))
         statement();
     patchJump(elseJump);
 }
@@ -1013,6 +1610,29 @@ static void whileStatement()
     emitByte(OP_POP);
 }
 
+/**
+ * Parses a do-while loop: the body runs once before the first test.
+ */
+static void doWhileStatement()
+{
+    int loopStart = currentChunk()->count;
+    statement();
+
+    consume(TOKEN_WHILE, "Expect 'while' after 'do' body.");
+    consume(TOKEN_LEFT_PAREN, "Expect '(' after 'while'.");
+    expression();
+    consume(TOKEN_RIGHT_PAREN, "Expect ')' after condition.");
+    consume(TOKEN_SEMICOLON, "Expect ';' after do-while condition.");
+
+    // Jump back while the condition holds, otherwise fall through
+    int exitJump = emitJump(OP_JUMP_IF_FALSE);
+    emitByte(OP_POP);
+    emitLoop(loopStart);
+
+    patchJump(exitJump);
+    emitByte(OP_POP);
+}
+
 /**
  * Synchronizes the parser after an error.
  */
@@ -1025,11 +1645,13 @@ static void synchronize()
             return;
         switch (parser.current.type) {
         case TOKEN_CLASS:
+        case TOKEN_IMPORT:
         case TOKEN_FUN:
         case TOKEN_VAR:
         case TOKEN_FOR:
         case TOKEN_IF:
         case TOKEN_WHILE:
+        case TOKEN_DO:
         case TOKEN_PRINT:
         case TOKEN_RETURN:
             return;
@@ -1058,6 +1680,12 @@ static void statement()
         returnStatement();
     } else if (match(TOKEN_WHILE)) {
         whileStatement();
+    } else if (match(TOKEN_DO)) {
+        doWhileStatement();
+    } else if (match(TOKEN_BREAK) || match(TOKEN_CONTINUE)) {
+        // Reserved by the grammar; loops have no early exits yet
+        error("'break' and 'continue' are not supported yet.");
+        consume(TOKEN_SEMICOLON, "Expect ';' after loop control.");
     } else if (match(TOKEN_LEFT_BRACE)) {
         beginScope();
         block();
@@ -1067,12 +1695,394 @@ static void statement()
     }
 }
 
+/* ====================== Modules ====================== */
+
+/**
+ * Makes a compilation unit current.
+ *
+ * @param file Unit to initialize
+ * @param path Path of the file it compiles
+ * @param module Namespace for a module, NULL for the main script
+ */
+static void beginUnit(CompilationUnit* file, std::string const& path, ObjString* module)
+{
+    file->path = path;
+    file->module = module;
+    file->source = NULL;
+    initTable(&file->declared);
+    initTable(&file->imports);
+    file->importHash = 0;
+    file->lazy = true;
+    file->parallel = false;
+    unit = file;
+}
+
+/**
+ * Releases the tables of a compilation unit.
+ */
+static void endUnit(CompilationUnit* file)
+{
+    freeTable(&file->declared);
+    freeTable(&file->imports);
+}
+
+/**
+ * Calls `visit` for every top-level token of a lexed file that is
+ * followed by another token.
+ *
+ * @param visit Receives the token's index
+ */
+template <typename Visit>
+static void forEachTopLevelToken(TokenStream* tokens, Visit visit)
+{
+    int depth = 0;
+    for (int i = 0; i + 1 < tokens->count; i++) {
+        switch ((TokenType)tokens->types[i]) {
+        case TOKEN_LEFT_BRACE:
+        case TOKEN_LEFT_PAREN:
+            depth++;
+            break;
+        case TOKEN_RIGHT_BRACE:
+        case TOKEN_RIGHT_PAREN:
+            depth--;
+            break;
+        default:
+            if (depth == 0)
+                visit(i);
+            break;
+        }
+    }
+}
+
+/**
+ * Lists the files a lexed file imports at the top level.
+ *
+ * @param tokens The file's token stream
+ * @param path Path of the file, which import paths are relative to
+ * @param imports Receives the resolved paths, in order
+ */
+static void collectImports(TokenStream* tokens, std::string const& path, std::vector<std::string>* imports)
+{
+    forEachTopLevelToken(tokens, [&](int i) {
+        if (tokens->types[i] == TOKEN_IMPORT && tokens->types[i + 1] == TOKEN_STRING) {
+            char const* start = tokens->source + tokens->offsets[i + 1];
+            imports->push_back(resolveModulePath(path, start + 1, (int)tokens->lengths[i + 1] - 2));
+        }
+    });
+}
+
+static void precompileModules(std::vector<std::string> const& paths);
+
+/**
+ * Looks ahead over the top level of a lexed file before compiling it.
+ *
+ * Records the globals a module declares, so references to them can be
+ * qualified even before the declaration, and gets every imported file
+ * ready up front: the main script has its modules compiled in parallel,
+ * and a module compiled on the main thread has its imports read and
+ * lexed in parallel.
+ *
+ * @param tokens The file's token stream
+ */
+static void scanTopLevel(TokenStream* tokens)
+{
+    if (unit->module != NULL) {
+        forEachTopLevelToken(tokens, [&](int i) {
+            TokenType type = (TokenType)tokens->types[i];
+            if ((type == TOKEN_FUN || type == TOKEN_VAR) && tokens->types[i + 1] == TOKEN_IDENTIFIER) {
+                char const* start = tokens->source + tokens->offsets[i + 1];
+                int length = (int)tokens->lengths[i + 1];
+                tableSet(&unit->declared, copyString(start, length),
+                    OBJ_VAL(qualifiedName(unit->module, start, length)));
+            }
+        });
+    }
+
+    std::vector<std::string> imports;
+    collectImports(tokens, unit->path, &imports);
+
+    // Stubs could not resolve `module.name` once the tables are gone
+    if (!imports.empty() || unit->module != NULL)
+        unit->lazy = false;
+
+    if (unit->module == NULL)
+        precompileModules(imports);
+    else if (!unit->parallel) // A worker's imports are compiled already
+        prefetchModules(imports.data(), (int)imports.size());
+}
+
+/**
+ * Checks that a module's file name can be used as a namespace.
+ */
+static bool isModuleName(std::string const& name)
+{
+    if (name.empty() || !(isalpha((unsigned char)name[0]) || name[0] == '_'))
+        return false;
+    for (char c : name) {
+        if (!isalnum((unsigned char)c) && c != '_')
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Compiles an imported file into a module.
+ *
+ * The importing file's parser, arena and unit are set aside and restored
+ * afterwards; its Compiler stays on the `current` chain and becomes
+ * current again when the module's endCompiler() returns.
+ *
+ * @param source Lexed module source
+ * @param parallel Whether precompileModules() runs the compile: errors
+ *                 are only recorded, the code heap is left unsealed and
+ *                 the module is returned without being cached
+ * @return The module, or NULL if it has compile errors
+ */
+static ObjModule* compileModule(ModuleSource* source, bool parallel)
+{
+    Parser enclosingParser = parser;
+    Arena enclosingArena = compilerArena;
+    CompilationUnit* enclosingUnit = unit;
+    bool enclosingMutate = canMutate;
+    canMutate = false; // Only the script being run is ever mutated
+
+    ObjString* name = copyString(source->name.data(), (int)source->name.size());
+    CompilationUnit file;
+    beginUnit(&file, source->path, name);
+    file.source = source;
+    file.parallel = parallel;
+    source->compiling = true;
+    source->imports.clear();
+
+    parser = Parser {};
+    parser.tokens = &source->tokens;
+    initArena(&compilerArena);
+    Compiler* compiler = ARENA_ALLOCATE(&compilerArena, Compiler, 1);
+    initCompiler(compiler, TYPE_SCRIPT, NULL);
+    current->function->name = name;
+
+    scanTopLevel(&source->tokens);
+    advance();
+    while (!match(TOKEN_EOF)) {
+        declaration();
+    }
+
+    ObjFunction* function = endCompiler();
+    if (!parallel)
+        sealCodeHeap(); // Workers may still be storing code
+    freeArena(&compilerArena);
+    bool failed = parser.hadError;
+
+    endUnit(&file);
+    source->compiling = false;
+    if (!failed || !parallel) {
+        // A failed worker keeps the tokens for the main thread, which
+        // compiles the module again to report the errors
+        freeTokenStream(&source->tokens);
+        source->lexed = false;
+    }
+
+    parser = enclosingParser;
+    compilerArena = enclosingArena;
+    unit = enclosingUnit;
+    canMutate = enclosingMutate;
+
+    if (failed)
+        return NULL;
+    ObjModule* module = newModule(name, function);
+    if (!parallel)
+        source->module = module;
+    return module;
+}
+
+/**
+ * Compiles the modules a script imports, directly or through other
+ * modules, on worker threads before the script itself is compiled.
+ *
+ * Modules compile in rounds: each round takes every module whose own
+ * imports are all compiled, so independent modules compile at the same
+ * time. Each worker allocates from a local heap that the main thread
+ * merges after the round. Modules that fail, import themselves or
+ * cannot be read are left to importModule(), which compiles them again
+ * on the main thread and reports why.
+ *
+ * @param paths Resolved paths of the script's imports
+ */
+static void precompileModules(std::vector<std::string> const& paths)
+{
+    // Find the modules still to compile, lexing each level in parallel
+    std::vector<ModuleSource*> pending;
+    std::vector<std::vector<std::string>> dependencies;
+    std::unordered_set<ModuleSource*> seen;
+    std::vector<std::string> level = paths;
+    while (!level.empty()) {
+        prefetchModules(level.data(), (int)level.size());
+        std::vector<std::string> next;
+        for (std::string const& path : level) {
+            ModuleSource* source = loadModule(path);
+            if (source == NULL || !seen.insert(source).second || source->module != NULL
+                || !isModuleName(source->name))
+                continue;
+            std::vector<std::string> imports;
+            collectImports(&source->tokens, source->path, &imports);
+            next.insert(next.end(), imports.begin(), imports.end());
+            pending.push_back(source);
+            dependencies.push_back(std::move(imports));
+        }
+        level = std::move(next);
+    }
+    if (pending.size() < 2)
+        return; // Nothing to overlap; importModule() compiles it
+
+    std::vector<bool> done(pending.size(), false);
+    for (;;) {
+        std::vector<ModuleSource*> round;
+        for (size_t i = 0; i < pending.size(); i++) {
+            bool ready = !done[i];
+            for (size_t j = 0; ready && j < dependencies[i].size(); j++) {
+                ModuleSource* imported = findModule(dependencies[i][j]);
+                ready = imported != NULL && imported->module != NULL;
+            }
+            if (ready) {
+                round.push_back(pending[i]);
+                done[i] = true;
+            }
+        }
+        if (round.empty())
+            break;
+
+        std::vector<LocalHeap> heaps(round.size());
+        std::vector<ObjModule*> modules(round.size());
+        forEachParallel(round.size(), [&](size_t index) {
+            initLocalHeap(&heaps[index]);
+            localHeap = &heaps[index];
+            modules[index] = compileModule(round[index], true);
+            localHeap = NULL;
+        });
+
+        // Publish the modules only once their strings are canonical
+        for (size_t index = 0; index < round.size(); index++) {
+            mergeLocalHeap(&heaps[index]);
+            round[index]->module = modules[index];
+        }
+    }
+    sealCodeHeap();
+}
+
+/**
+ * Claims the namespaces of the modules a compiled module imports, in the
+ * order compiling it would.
+ *
+ * @param source Entry of a compiled module
+ * @return false if a namespace is held by another file (or an imported
+ *         module is no longer compiled)
+ */
+static bool claimImportedNames(ModuleSource* source)
+{
+    for (ModuleSource* imported : source->imports) {
+        if (claimModuleName(imported) != NULL || imported->module == NULL
+            || !claimImportedNames(imported))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Returns the module for an import path, compiling it on first use.
+ *
+ * @param path The string token of the import statement
+ * @return The module, or NULL after reporting an error
+ */
+static ObjModule* importModule(Token* path)
+{
+    std::string resolved = resolveModulePath(unit->path, path->start + 1, path->length - 2);
+    if (unit->parallel) {
+        // Workers only compile modules whose imports are compiled already
+        ModuleSource* source = findModule(resolved);
+        if (source == NULL || source->module == NULL) {
+            errorAt(path, "Could not compile module.");
+            return NULL;
+        }
+        unit->source->imports.push_back(source);
+        return source->module;
+    }
+
+    ModuleSource* source = loadModule(resolved);
+    if (source == NULL) {
+        errorAt(path, "Could not read module.");
+        return NULL;
+    }
+    if (source->compiling) {
+        errorAt(path, "Module imports itself through a cycle.");
+        return NULL;
+    }
+    std::string const* owner = claimModuleName(source);
+    if (owner != NULL) {
+        std::string message = "Module name '" + source->name + "' is already used by " + *owner + ".";
+        errorAt(path, message.c_str());
+        return NULL;
+    }
+    if (source->module != NULL && !claimImportedNames(source)) {
+        // Compiling the module again reports the clash where it happens
+        source->module = NULL;
+        source = loadModule(resolved);
+        if (source == NULL) {
+            errorAt(path, "Could not read module.");
+            return NULL;
+        }
+    }
+
+    // Otherwise compiled by an earlier import or by precompileModules()
+    if (source->module == NULL) {
+        if (!isModuleName(source->name)) {
+            errorAt(path, "Module file name must be a valid identifier.");
+            return NULL;
+        }
+        if (compileModule(source, false) == NULL) {
+            errorAt(path, "Could not compile module.");
+            return NULL;
+        }
+    }
+
+    if (unit->source != NULL)
+        unit->source->imports.push_back(source);
+    return source->module;
+}
+
+/**
+ * Parses an import statement and emits code that runs the module once.
+ */
+static void importDeclaration()
+{
+    if (current->type != TYPE_SCRIPT || current->scopeDepth > 0)
+        error("Can only import at the top level.");
+
+    consume(TOKEN_STRING, "Expect module path after 'import'.");
+    Token path = parser.previous;
+    consume(TOKEN_SEMICOLON, "Expect ';' after import.");
+    if (parser.panicMode)
+        return;
+
+    ObjModule* module = importModule(&path);
+    if (module == NULL)
+        return;
+
+    tableSet(&unit->imports, module->name, OBJ_VAL(module));
+    unit->importHash = unit->importHash * 0x100000001b3ull
+        ^ std::hash<std::string_view>()(std::string_view(module->name->chars, module->name->length));
+    emitConstant(OBJ_VAL(module));
+    emitByte(OP_IMPORT);
+    emitByte(OP_POP);
+}
+
 /**
  * Parses a declaration (variable, function, or statement).
  */
 static void declaration()
 {
-    if (match(TOKEN_FUN)) {
+    if (match(TOKEN_IMPORT)) {
+        importDeclaration();
+    } else if (match(TOKEN_FUN)) {
         funDeclaration();
     } else if (match(TOKEN_VAR)) {
         varDeclaration();
@@ -1087,13 +2097,15 @@ static void declaration()
 /* ====================== Compiler Interface ====================== */
 
 /**
- * Finalizes the compilation process by emitting a return instruction
- * and optionally disassembling the generated code.
+ * Finalizes the compilation process by emitting a return instruction,
+ * moving the finished bytecode into the code heap and optionally
+ * disassembling the generated code.
  */
 static ObjFunction* endCompiler()
 {
     emitReturn();
     ObjFunction* function = current->function;
+    sealChunk(&function->chunk);
 
 #ifdef DEBUG_PRINT_CODE
     if (!parser.hadError) {
@@ -1109,19 +2121,42 @@ static ObjFunction* endCompiler()
  * Compiles the given source code into bytecode.
  *
  * @param source The source code string.
- * @param chunk The chunk where compiled bytecode will be stored.
+ * @param length Length of the source in bytes.
  * @return true if compilation is successful, false if there are errors.
  */
-ObjFunction* compile(char const* source)
+ObjFunction* compile(char const* source, size_t length)
 {
-    initLexer(source); // Initialize the lexer with the source code.
-    Compiler compiler;
-    initCompiler(&compiler, TYPE_SCRIPT);
+    CompilationUnit script;
+    beginUnit(&script, sourcePath, NULL);
+    beginFunctionCache(source, length);
+
+    // Lex the whole script first when TOKEN_STREAM asks for it, or when it
+    // may import modules, so they can be found and read up front. Fall back
+    // to on-demand lexing if it is too large for 32-bit offsets.
+    parser.tokens = NULL;
+#ifdef TOKEN_STREAM
+    bool stream = true;
+#else
+    bool stream = std::string_view(source, length).find("import") != std::string_view::npos;
+#endif
+    if (stream && tokenizeSource(&scriptTokens, source, length)) {
+        parser.tokens = &scriptTokens;
+        parser.nextToken = 0;
+        parser.lineCursor = 0;
+    } else {
+        initLexer(source, length); // Initialize the lexer with the source code.
+    }
+    initArena(&compilerArena);
+    Compiler* compiler = ARENA_ALLOCATE(&compilerArena, Compiler, 1);
+    initCompiler(compiler, TYPE_SCRIPT, NULL);
     // compilingChunk = chunk; // Set the chunk where compiled bytecode will be stored.
 
     parser.hadError = false;  // Reset error state before compilation starts.
     parser.panicMode = false; // Reset panic mode to handle errors gracefully.
+    canMutate = true;         // A server compiles many scripts per process
 
+    if (parser.tokens != NULL)
+        scanTopLevel(parser.tokens);
     advance(); // Fetch the first token from the lexer.
 
     while (!match(TOKEN_EOF)) { // Keep compiling declarations until EOF is hit
@@ -1129,5 +2164,44 @@ ObjFunction* compile(char const* source)
     }
 
     ObjFunction* function = endCompiler();
+    sealCodeHeap();
+    freeArena(&compilerArena); // Every chunk is sealed; drop the scratch data
+    freeTokenStream(&scriptTokens);
+    parser.tokens = NULL;
+    endFunctionCache(!parser.hadError);
+    endUnit(&script);
+    unit = NULL;
     return parser.hadError ? NULL : function;
 }
+
+/**
+ * Compiles the body of a lazily scanned function in place.
+ *
+ * @param function Stub produced while compiling with LAZY_COMPILE
+ * @return true if the body compiled without errors.
+ */
+bool compileFunction(ObjFunction* function)
+{
+    // Lazily compiled bodies are short; lex them on demand
+    resetLexer(function->body.start, function->body.line);
+    parser.tokens = NULL;
+    parser.hadError = false;
+    parser.panicMode = false;
+
+    // Start from a clean chunk; the parameters are declared again below.
+    freeChunk(&function->chunk);
+    function->arity = 0;
+
+    initArena(&compilerArena);
+    Compiler* compiler = ARENA_ALLOCATE(&compilerArena, Compiler, 1);
+    initCompiler(compiler, TYPE_FUNCTION, function);
+
+    advance(); // Fetch the opening '(' of the parameter list.
+    functionBody();
+    endCompiler();
+    sealCodeHeap();
+    freeArena(&compilerArena);
+
+    function->compiled = !parser.hadError;
+    return function->compiled;
+}
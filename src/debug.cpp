@@ -1,7 +1,7 @@
 #include "debug.h"  // For disassembly declarations
 #include "chunk.h"  // For bytecode chunk structure
 #include "value.h"  // For constant value printing
-#include <iostream> // For output operations
+#include "vm.h"     // For the VM output buffer
 
 /**
  * Disassembles an entire chunk of bytecode for debugging purposes.
@@ -16,7 +16,7 @@
  */
 void disassembleChunk(Chunk* chunk, char const* name)
 {
-    std::cout << "== " << name << " ==" << std::endl;
+    outputFormat(&vm.output, "== %s ==\n", name);
 
     // Iterate through all instructions in chunk
     for (int offset = 0; offset < chunk->count;) {
@@ -37,12 +37,34 @@ void disassembleChunk(Chunk* chunk, char const* name)
 static int constantInstruction(char const* name, Chunk* chunk, int offset)
 {
     uint8_t constant = chunk->code[offset + 1]; // Get constant index
-    printf("%-16s %4d '", name, constant);
+    outputFormat(&vm.output, "%-16s %4d '", name, constant);
     printValue(chunk->constants.values[constant]); // Print constant value
-    printf("'\n");
+    outputFormat(&vm.output, "'\n");
     return offset + 2; // Advance past opcode + operand
 }
 
+/**
+ * Disassembles a constant-load instruction with a 24-bit pool index
+ * (OP_CONSTANT_LONG and the *_GLOBAL_LONG variants).
+ *
+ * @param name Mnemonic name of the instruction
+ * @param chunk Containing chunk
+ * @param offset Starting byte offset of instruction
+ * @return New offset after processing this instruction
+ *
+ * @format: "OP_CONSTANT_LONG  300 'value'"
+ */
+static int constantLongInstruction(char const* name, Chunk* chunk, int offset)
+{
+    uint32_t constant = (uint32_t)(chunk->code[offset + 1] << 16)
+        | (uint32_t)(chunk->code[offset + 2] << 8)
+        | chunk->code[offset + 3];
+    outputFormat(&vm.output, "%-16s %4u '", name, constant);
+    printValue(chunk->constants.values[constant]);
+    outputFormat(&vm.output, "'\n");
+    return offset + 4; // Advance past opcode + 3-byte operand
+}
+
 /**
  * Disassembles a simple instruction with no operands.
  *
@@ -54,7 +76,7 @@ static int constantInstruction(char const* name, Chunk* chunk, int offset)
  */
 static int simpleInstruction(char const* name, int offset)
 {
-    std::cout << name << std::endl;
+    outputFormat(&vm.output, "%s\n", name);
     return offset + 1; // Advance past single-byte opcode
 }
 
@@ -71,7 +93,7 @@ static int simpleInstruction(char const* name, int offset)
 static int byteInstruction(char const* name, Chunk* chunk, int offset)
 {
     uint8_t slot = chunk->code[offset + 1]; // Get 1-byte operand
-    printf("%-16s %4d\n", name, slot);
+    outputFormat(&vm.output, "%-16s %4d\n", name, slot);
     return offset + 2; // Advance past opcode + 1-byte operand
 }
 
@@ -93,11 +115,36 @@ static int jumpInstruction(char const* name, int sign,
     uint16_t jump = (uint16_t)(chunk->code[offset + 1] << 8);
     jump |= chunk->code[offset + 2];
     // Show absolute jump target
-    printf("%-16s %4d -> %d\n", name, offset,
+    outputFormat(&vm.output, "%-16s %4d -> %d\n", name, offset,
         offset + 3 + sign * jump);
     return offset + 3; // Advance past opcode + 2-byte operand
 }
 
+/**
+ * Disassembles a counted-loop step instruction.
+ *
+ * @param name Mnemonic name
+ * @param chunk Containing chunk
+ * @param offset Starting byte offset
+ * @return New offset after instruction
+ *
+ * @format: "OP_FOR_STEP      slot 1 step '1' mode 0 limit 2 -> 14"
+ */
+static int forStepInstruction(char const* name, Chunk* chunk, int offset)
+{
+    uint8_t slot = chunk->code[offset + 1];
+    uint8_t step = chunk->code[offset + 2];
+    uint8_t mode = chunk->code[offset + 3];
+    uint8_t limit = chunk->code[offset + 4];
+    uint16_t jump = (uint16_t)(chunk->code[offset + 5] << 8);
+    jump |= chunk->code[offset + 6];
+
+    outputFormat(&vm.output, "%-16s slot %d step '", name, slot);
+    printValue(chunk->constants.values[step]);
+    outputFormat(&vm.output, "' mode %d limit %d -> %d\n", mode, limit, offset + 7 - jump);
+    return offset + 7; // Advance past opcode + 6 operand bytes
+}
+
 /**
  * Disassembles a single instruction at given offset.
  *
@@ -112,13 +159,14 @@ static int jumpInstruction(char const* name, int sign,
 int disassembleInstruction(Chunk* chunk, int offset)
 {
     // Print instruction offset (4-digit padded)
-    printf("%04d ", offset);
+    outputFormat(&vm.output, "%04d ", offset);
 
     // Show line number or continuation marker
-    if (offset > 0 && chunk->lines[offset] == chunk->lines[offset - 1]) {
-        std::cout << "    | ";
+    int line = getLine(chunk, offset);
+    if (offset > 0 && line == getLine(chunk, offset - 1)) {
+        outputString(&vm.output, "    | ");
     } else {
-        printf("%4d ", chunk->lines[offset]);
+        outputFormat(&vm.output, "%4d ", line);
     }
 
     // Decode and print instruction
@@ -127,6 +175,8 @@ int disassembleInstruction(Chunk* chunk, int offset)
     switch (instruction) {
     case OP_CONSTANT:
         return constantInstruction("OP_CONSTANT", chunk, offset);
+    case OP_CONSTANT_LONG:
+        return constantLongInstruction("OP_CONSTANT_LONG", chunk, offset);
     case OP_NIL:
         return simpleInstruction("OP_NIL", offset);
     case OP_TRUE:
@@ -145,6 +195,12 @@ int disassembleInstruction(Chunk* chunk, int offset)
         return constantInstruction("OP_DEFINE_GLOBAL", chunk, offset);
     case OP_SET_GLOBAL:
         return constantInstruction("OP_SET_GLOBAL", chunk, offset);
+    case OP_GET_GLOBAL_LONG:
+        return constantLongInstruction("OP_GET_GLOBAL_LONG", chunk, offset);
+    case OP_DEFINE_GLOBAL_LONG:
+        return constantLongInstruction("OP_DEFINE_GLOBAL_LONG", chunk, offset);
+    case OP_SET_GLOBAL_LONG:
+        return constantLongInstruction("OP_SET_GLOBAL_LONG", chunk, offset);
     case OP_EQUAL:
         return simpleInstruction("OP_EQUAL", offset);
     case OP_GREATER:
@@ -163,6 +219,8 @@ int disassembleInstruction(Chunk* chunk, int offset)
         return simpleInstruction("OP_NOT", offset);
     case OP_NEGATE:
         return simpleInstruction("OP_NEGATE", offset);
+    case OP_CONCAT_N:
+        return byteInstruction("OP_CONCAT_N", chunk, offset);
     case OP_PRINTLN:
         return simpleInstruction("OP_PRINTLN", offset);
     case OP_PRINT:
@@ -173,12 +231,16 @@ int disassembleInstruction(Chunk* chunk, int offset)
         return jumpInstruction("OP_JUMP_IF_FALSE", 1, chunk, offset);
     case OP_LOOP:
         return jumpInstruction("OP_LOOP", -1, chunk, offset);
+    case OP_FOR_STEP:
+        return forStepInstruction("OP_FOR_STEP", chunk, offset);
     case OP_CALL:
         return byteInstruction("OP_CALL", chunk, offset);
     case OP_RETURN:
         return simpleInstruction("OP_RETURN", offset);
+    case OP_IMPORT:
+        return simpleInstruction("OP_IMPORT", offset);
     default:
-        std::cout << "Unknown opcode " << instruction << std::endl;
+        outputFormat(&vm.output, "Unknown opcode %d\n", instruction);
         return offset + 1;
     }
 }
@@ -0,0 +1,184 @@
+#include <cstring> // For memcmp
+
+#include "intern.h" // For InternSet declarations
+#include "memory.h" // For memory allocation macros
+#include "object.h" // For ObjString definition
+
+// Maximum load factor before growing the set (3/4)
+#define INTERN_MAX_LOAD(capacity) ((capacity) / 4 * 3)
+
+// Smallest non-zero capacity
+#define INTERN_MIN_CAPACITY 64
+
+/**
+ * Initializes an empty intern set.
+ *
+ * @param set Pointer to uninitialized InternSet structure
+ */
+void initInternSet(InternSet* set)
+{
+    set->count = 0;
+    set->capacity = 0;
+    set->hashes = NULL;
+    set->strings = NULL;
+}
+
+/**
+ * Releases the slot arrays of an intern set.
+ *
+ * @param set Set to deallocate
+ */
+void freeInternSet(InternSet* set)
+{
+    FREE_ARRAY(uint32_t, set->hashes, set->capacity);
+    FREE_ARRAY(ObjString*, set->strings, set->capacity);
+    initInternSet(set);
+}
+
+/**
+ * Stores a string in the first free slot of its probe sequence.
+ *
+ * @note The caller guarantees there is a free slot
+ */
+static void insertSlot(InternSet* set, ObjString* string, uint32_t hash)
+{
+    uint32_t mask = (uint32_t)set->capacity - 1;
+    uint32_t index = hash & mask;
+    while (set->strings[index] != NULL)
+        index = (index + 1) & mask;
+
+    set->hashes[index] = hash;
+    set->strings[index] = string;
+}
+
+/**
+ * Rehashes the set into `capacity` slots.
+ *
+ * @param set Set to resize
+ * @param capacity New capacity (power of two, larger than the count)
+ */
+static void adjustCapacity(InternSet* set, int capacity)
+{
+    InternSet resized;
+    resized.count = set->count;
+    resized.capacity = capacity;
+    resized.hashes = ALLOCATE(uint32_t, capacity);
+    resized.strings = ALLOCATE(ObjString*, capacity);
+    for (int i = 0; i < capacity; i++)
+        resized.strings[i] = NULL;
+
+    // Cached hashes make rehashing a pass over two flat arrays
+    for (int i = 0; i < set->capacity; i++) {
+        if (set->strings[i] != NULL)
+            insertSlot(&resized, set->strings[i], set->hashes[i]);
+    }
+
+    freeInternSet(set);
+    *set = resized;
+}
+
+/**
+ * Grows the set so `count` strings fit under the load limit.
+ *
+ * @param set Set to grow
+ * @param count Expected total number of strings
+ *
+ * @note Never shrinks the set
+ */
+void internSetReserve(InternSet* set, int count)
+{
+    int capacity = set->capacity == 0 ? INTERN_MIN_CAPACITY : set->capacity;
+    while (count > INTERN_MAX_LOAD(capacity))
+        capacity *= 2;
+
+    if (capacity != set->capacity)
+        adjustCapacity(set, capacity);
+}
+
+/**
+ * Finds a string by content.
+ *
+ * @param set Set to search
+ * @param chars String characters to match
+ * @param length Length of string in bytes
+ * @param hash Hash of the string
+ * @return Existing ObjString if found, NULL otherwise
+ */
+ObjString* internSetFind(InternSet* set, char const* chars, int length, uint32_t hash)
+{
+    if (set->count == 0)
+        return NULL;
+
+    uint32_t mask = (uint32_t)set->capacity - 1;
+    uint32_t index = hash & mask;
+    for (;;) {
+        ObjString* string = set->strings[index];
+        if (string == NULL)
+            return NULL; // No tombstones: an empty slot ends the probe
+
+        // The string is only touched when the full hash matches
+        if (set->hashes[index] == hash && string->length == length
+            && memcmp(string->chars, chars, length) == 0)
+            return string;
+
+        index = (index + 1) & mask;
+    }
+}
+
+/**
+ * Adds a string to the set.
+ *
+ * @param set Set to modify
+ * @param string Hashed string, not already present
+ */
+void internSetAdd(InternSet* set, ObjString* string)
+{
+    if (set->count + 1 > INTERN_MAX_LOAD(set->capacity))
+        internSetReserve(set, set->count + 1);
+
+    insertSlot(set, string, string->hash);
+    set->count++;
+}
+
+/**
+ * Empties a slot and shifts later entries of the same cluster back so
+ * that every remaining string is still reachable from its home slot.
+ */
+static void removeSlot(InternSet* set, uint32_t index)
+{
+    uint32_t mask = (uint32_t)set->capacity - 1;
+    uint32_t hole = index;
+    uint32_t next = (hole + 1) & mask;
+
+    while (set->strings[next] != NULL) {
+        uint32_t home = set->hashes[next] & mask;
+        // Move the entry into the hole unless its home lies cyclically
+        // in (hole, next], where the hole is not on its probe path
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            set->hashes[hole] = set->hashes[next];
+            set->strings[hole] = set->strings[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    set->strings[hole] = NULL;
+    set->count--;
+}
+
+/**
+ * Removes every string the predicate rejects.
+ *
+ * @param set Set to prune
+ * @param isLive Returns false for strings about to be freed
+ *
+ * @note A slot is re-examined after a removal, since backward shifting
+ *       may have moved another string into it
+ */
+void internSetRemoveWhere(InternSet* set, bool (*isLive)(ObjString* string))
+{
+    for (int i = 0; i < set->capacity; i++) {
+        while (set->strings[i] != NULL && !isLive(set->strings[i]))
+            removeSlot(set, (uint32_t)i);
+    }
+}
@@ -1,10 +1,52 @@
 #include <cctype>  // For character classification functions
+#include <cstdint> // For uint64_t
+#include <cstdio>  // For error output
+#include <cstdlib> // For realloc/free
 #include <cstring> // For string operations
 
+#ifdef __SSE2__
+#include <emmintrin.h> // For 16-byte scanning fast paths
+#endif
+
 #include "lexer.h" // For token definitions
 
-// Global lexer state (single instance)
-static Lexer lexer;
+// ======================
+// Character Classes
+// ======================
+
+#define CLASS_ALPHA 0x01 // a-z, A-Z, _
+#define CLASS_DIGIT 0x02 // 0-9
+#define CLASS_SPACE 0x04 // ' ', '\t', '\r' (newlines are counted separately)
+
+/**
+ * Lookup table mapping each byte to its CLASS_* bits.
+ */
+struct CharClassTable {
+    unsigned char classes[256];
+
+    constexpr CharClassTable()
+        : classes()
+    {
+        for (int c = 'a'; c <= 'z'; c++)
+            classes[c] |= CLASS_ALPHA;
+        for (int c = 'A'; c <= 'Z'; c++)
+            classes[c] |= CLASS_ALPHA;
+        classes['_'] |= CLASS_ALPHA;
+        for (int c = '0'; c <= '9'; c++)
+            classes[c] |= CLASS_DIGIT;
+        classes[' '] |= CLASS_SPACE;
+        classes['\t'] |= CLASS_SPACE;
+        classes['\r'] |= CLASS_SPACE;
+    }
+};
+
+static constexpr CharClassTable charClass;
+
+/** Returns true if `c` has any of the given class bits */
+#define HAS_CLASS(c, bits) ((charClass.classes[(unsigned char)(c)] & (bits)) != 0)
+
+// Lexer state, one per thread so modules can be lexed in parallel
+static thread_local Lexer lexer;
 
 char const* getLexer()
 {
@@ -14,16 +56,31 @@ char const* getLexer()
 /**
  * Initializes the lexer with source code to tokenize.
  *
- * @param source Null-terminated source string
+ * @param source Source text; scanning stops at `source + length`
+ * @param length Length of the source in bytes
  *
  * @note Source must persist through tokenization
  */
-void initLexer(char const* source)
+void initLexer(char const* source, size_t length)
 {
     lexer.start = source;
     lexer.current = source;
     lexer.line = 1;
     lexer.source = source;
+    lexer.end = source + length;
+}
+
+/**
+ * Repositions the lexer inside its current source.
+ *
+ * @param start Position to resume scanning from
+ * @param line Line number of `start`
+ */
+void resetLexer(char const* start, int line)
+{
+    lexer.start = start;
+    lexer.current = start;
+    lexer.line = line;
 }
 
 /**
@@ -31,7 +88,7 @@ void initLexer(char const* source)
  */
 static bool isAtEnd()
 {
-    return *lexer.current == '\0';
+    return lexer.current >= lexer.end;
 }
 
 /**
@@ -87,6 +144,8 @@ static bool match(char expected)
  */
 static char peek()
 {
+    if (isAtEnd())
+        return '\0';
     return *lexer.current;
 }
 
@@ -95,7 +154,7 @@ static char peek()
  */
 static char peekNext()
 {
-    if (isAtEnd())
+    if (lexer.current + 1 >= lexer.end)
         return '\0';
     return lexer.current[1];
 }
@@ -105,7 +164,7 @@ static char peekNext()
  */
 static bool isDigit(char c)
 {
-    return c >= '0' && c <= '9';
+    return HAS_CLASS(c, CLASS_DIGIT);
 }
 
 /**
@@ -113,19 +172,165 @@ static bool isDigit(char c)
  */
 static bool isAlpha(char c)
 {
-    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    return HAS_CLASS(c, CLASS_ALPHA);
 }
 
+// ======================
+// Block Scanning
+// ======================
+
 /**
- * Scans a string literal until closing quote.
+ * Number of bytes that can be loaded as one block without reading past
+ * the end of the source.
  */
-static Token string()
+#define BLOCK_SIZE 16
+
+/**
+ * Checks if a whole block starting at the current position is in bounds.
+ */
+static bool blockAvailable()
+{
+    return lexer.end - lexer.current >= BLOCK_SIZE;
+}
+
+#ifdef __SSE2__
+
+/** Loads the block at the current position */
+static inline __m128i loadBlock()
+{
+    return _mm_loadu_si128((__m128i const*)lexer.current);
+}
+
+/** Bit mask of the bytes in `block` equal to `c` */
+static inline unsigned byteMask(__m128i block, char c)
+{
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(c)));
+}
+
+/** Bit mask of the bytes in `block` within ['lo', 'hi'] (ASCII only) */
+static inline unsigned rangeMask(__m128i block, char lo, char hi)
 {
+    // Signed compares: bytes >= 0x80 are negative and never match
+    __m128i above = _mm_cmpgt_epi8(block, _mm_set1_epi8((char)(lo - 1)));
+    __m128i below = _mm_cmplt_epi8(block, _mm_set1_epi8((char)(hi + 1)));
+    return (unsigned)_mm_movemask_epi8(_mm_and_si128(above, below));
+}
+
+/** Number of leading set bits of a 16-bit mask (block positions) */
+static inline int leadingRun(unsigned mask)
+{
+    return __builtin_ctz(~mask | 0x10000u);
+}
+
+/** Bits below position `count` */
+static inline unsigned lowBits(int count)
+{
+    return (1u << count) - 1;
+}
+
+#endif // __SSE2__
+
+/**
+ * Skips over identifier characters ([A-Za-z0-9_]) in blocks.
+ */
+static void skipIdentifierRun()
+{
+#ifdef __SSE2__
+    while (blockAvailable()) {
+        __m128i block = loadBlock();
+        __m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20)); // Fold case
+        unsigned mask = rangeMask(lower, 'a', 'z') | rangeMask(block, '0', '9')
+            | byteMask(block, '_');
+        int run = leadingRun(mask);
+        lexer.current += run;
+        if (run < BLOCK_SIZE)
+            return;
+    }
+#endif
+    while (HAS_CLASS(peek(), CLASS_ALPHA | CLASS_DIGIT))
+        advance();
+}
+
+/**
+ * Skips over spaces, tabs, carriage returns and newlines, counting the
+ * newlines into lexer.line.
+ */
+static void skipBlankRun()
+{
+    // Most runs are a single space between tokens; only longer runs
+    // (indentation, blank lines) are worth a block scan
+    if (peek() == '\n')
+        lexer.line++;
+    advance();
+    if (!HAS_CLASS(peek(), CLASS_SPACE) && peek() != '\n')
+        return;
+
+#ifdef __SSE2__
+    while (blockAvailable()) {
+        __m128i block = loadBlock();
+        unsigned newlines = byteMask(block, '\n');
+        unsigned mask = newlines | byteMask(block, ' ') | byteMask(block, '\t')
+            | byteMask(block, '\r');
+        int run = leadingRun(mask);
+        lexer.line += __builtin_popcount(newlines & lowBits(run));
+        lexer.current += run;
+        if (run < BLOCK_SIZE)
+            return;
+    }
+#endif
+    for (;;) {
+        char c = peek();
+        if (c == '\n')
+            lexer.line++;
+        else if (!HAS_CLASS(c, CLASS_SPACE))
+            return;
+        advance();
+    }
+}
+
+/**
+ * Moves to the next '\n' (or the end of the source) without consuming it.
+ */
+static void skipToLineEnd()
+{
+    void const* newline = memchr(lexer.current, '\n', lexer.end - lexer.current);
+    lexer.current = newline != NULL ? (char const*)newline : lexer.end;
+}
+
+/**
+ * Skips the body of a string literal up to the closing quote (or the end
+ * of the source), counting newlines inside it into lexer.line.
+ */
+static void skipStringBody()
+{
+#ifdef __SSE2__
+    while (blockAvailable()) {
+        __m128i block = loadBlock();
+        unsigned newlines = byteMask(block, '\n');
+        unsigned quotes = byteMask(block, '"');
+        if (quotes != 0) {
+            int length = __builtin_ctz(quotes);
+            lexer.line += __builtin_popcount(newlines & lowBits(length));
+            lexer.current += length;
+            return;
+        }
+        lexer.line += __builtin_popcount(newlines);
+        lexer.current += BLOCK_SIZE;
+    }
+#endif
     while (peek() != '"' && !isAtEnd()) {
         if (peek() == '\n')
             lexer.line++;
         advance();
     }
+}
+
+/**
+ * Scans a string literal until closing quote.
+ */
+static Token string()
+{
+    skipStringBody();
 
     if (isAtEnd())
         return errorToken("Unterminated string.");
@@ -136,6 +341,9 @@ static Token string()
 
 /**
  * Scans numeric literals (integer or float).
+ *
+ * @note Literals are short, so this stays a scalar loop over the
+ *       character class table
  */
 static Token number()
 {
@@ -152,80 +360,168 @@ static Token number()
     return makeToken(TOKEN_NUMBER);
 }
 
+// ======================
+// Keyword Recognition
+// ======================
+
 /**
- * Checks if current token matches a keyword.
+ * A reserved word and the token it produces.
  */
-static TokenType checkKeyword(int start, int length,
-    char const* rest, TokenType type)
+typedef struct Keyword {
+    char const* text; // Spelling
+    TokenType type;   // Token produced
+} Keyword;
+
+/**
+ * Every reserved word of the language, in one place.
+ *
+ * Covers the keywords of grammar.ebnf plus those the implementation
+ * adds (print, println, class, super, this). 'func' is the grammar's
+ * spelling of 'fun' and produces the same token. Adding a keyword means
+ * adding a row here; keywordTable below is rebuilt at compile time and
+ * fails to compile if the row collides with another.
+ */
+static constexpr Keyword keywords[] = {
+    { "and", TOKEN_AND },
+    { "break", TOKEN_BREAK },
+    { "class", TOKEN_CLASS },
+    { "continue", TOKEN_CONTINUE },
+    { "do", TOKEN_DO },
+    { "else", TOKEN_ELSE },
+    { "elseif", TOKEN_ELSEIF },
+    { "false", TOKEN_FALSE },
+    { "for", TOKEN_FOR },
+    { "fun", TOKEN_FUN },
+    { "func", TOKEN_FUN },
+    { "if", TOKEN_IF },
+    { "import", TOKEN_IMPORT },
+    { "nil", TOKEN_NIL },
+    { "or", TOKEN_OR },
+    { "print", TOKEN_PRINT },
+    { "println", TOKEN_PRINTLN },
+    { "return", TOKEN_RETURN },
+    { "super", TOKEN_SUPER },
+    { "this", TOKEN_THIS },
+    { "true", TOKEN_TRUE },
+    { "var", TOKEN_VAR },
+    { "while", TOKEN_WHILE },
+};
+
+// Keywords fit in one 64-bit word, which is compared in a single step
+#define KEYWORD_MAX_LENGTH 8
+
+// Slots in the perfect hash table (a power of two)
+#define KEYWORD_SLOTS 64
+
+/**
+ * Perfect hash of a keyword candidate: a weighted sum of the first and
+ * last character and the length, masked to the table size. The keyword
+ * table constructor checks that no two keywords share a slot; when adding
+ * a keyword breaks that, search for new weights.
+ */
+static constexpr unsigned keywordHash(int length, char first, char last)
+{
+    return ((unsigned char)first * 7u + (unsigned char)last * 2u + (unsigned)length)
+        & (KEYWORD_SLOTS - 1);
+}
+
+/**
+ * Packs up to KEYWORD_MAX_LENGTH characters into a word with the same
+ * byte order a memcpy of the source text produces.
+ */
+static constexpr uint64_t keywordWord(char const* text, int length)
 {
-    if (lexer.current - lexer.start == start + length && memcmp(lexer.start + start, rest, length) == 0) {
-        return type;
+    uint64_t word = 0;
+    for (int i = 0; i < length; i++) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word |= (uint64_t)(unsigned char)text[i] << (56 - 8 * i);
+#else
+        word |= (uint64_t)(unsigned char)text[i] << (8 * i);
+#endif
     }
-    return TOKEN_IDENTIFIER;
+    return word;
 }
 
+// Shifts a mask of the first N bytes of a memcpy-loaded word into place
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define KEYWORD_SHIFT(bits) >> (bits)
+#else
+#define KEYWORD_SHIFT(bits) << (bits)
+#endif
+
+/**
+ * Perfect hash table of the keywords, built at compile time.
+ */
+struct KeywordTable {
+    uint64_t words[KEYWORD_SLOTS];    // Packed spelling (0 for an empty slot)
+    uint8_t lengths[KEYWORD_SLOTS];   // Spelling length (0 for an empty slot)
+    TokenType types[KEYWORD_SLOTS];   // Token produced
+    bool collides;                    // Two keywords hash to one slot
+    bool tooLong;                     // A keyword exceeds KEYWORD_MAX_LENGTH
+
+    constexpr KeywordTable()
+        : words()
+        , lengths()
+        , types()
+        , collides(false)
+        , tooLong(false)
+    {
+        for (Keyword const& keyword : keywords) {
+            int length = 0;
+            while (keyword.text[length] != '\0')
+                length++;
+            if (length > KEYWORD_MAX_LENGTH) {
+                tooLong = true;
+                continue;
+            }
+
+            unsigned slot = keywordHash(length, keyword.text[0], keyword.text[length - 1]);
+            if (lengths[slot] != 0)
+                collides = true;
+            words[slot] = keywordWord(keyword.text, length);
+            lengths[slot] = (uint8_t)length;
+            types[slot] = keyword.type;
+        }
+    }
+};
+
+static constexpr KeywordTable keywordTable;
+
+static_assert(!keywordTable.collides,
+    "keywordHash() maps two keywords to one slot; change its mix or KEYWORD_SLOTS");
+static_assert(!keywordTable.tooLong,
+    "a keyword is longer than KEYWORD_MAX_LENGTH");
+
 /**
  * Determines if current identifier is a reserved keyword.
+ *
+ * One hash, one length check and one word compare per identifier.
  */
 static TokenType identifierType()
 {
-    switch (lexer.start[0]) {
-    case 'a':
-        return checkKeyword(1, 2, "nd", TOKEN_AND);
-    case 'c':
-        return checkKeyword(1, 4, "lass", TOKEN_CLASS);
-    case 'e':
-        return checkKeyword(1, 3, "lse", TOKEN_ELSE);
-    case 'f':
-        if (lexer.current - lexer.start > 1) {
-            switch (lexer.start[1]) {
-            case 'a':
-                return checkKeyword(2, 3, "lse", TOKEN_FALSE);
-            case 'o':
-                return checkKeyword(2, 1, "r", TOKEN_FOR);
-            case 'u':
-                return checkKeyword(2, 1, "n", TOKEN_FUN);
-            }
-        }
-        break;
-    case 'i':
-        return checkKeyword(1, 1, "f", TOKEN_IF);
-    case 'n':
-        return checkKeyword(1, 2, "il", TOKEN_NIL);
-    case 'o':
-        return checkKeyword(1, 1, "r", TOKEN_OR);
-    case 'p':
-        if (lexer.current - lexer.start > 1) {
-            switch (lexer.start[1]) {
-            case 'r':
-                if (lexer.current - lexer.start > 5 && memcmp(lexer.start + 2, "intln", 5) == 0) {
-                    return TOKEN_PRINTLN;
-                }
-                return checkKeyword(2, 3, "int", TOKEN_PRINT);
-            }
-        }
-        break;
-    case 'r':
-        return checkKeyword(1, 5, "eturn", TOKEN_RETURN);
-    case 's':
-        return checkKeyword(1, 4, "uper", TOKEN_SUPER);
-    case 't':
-        if (lexer.current - lexer.start > 1) {
-            switch (lexer.start[1]) {
-            case 'h':
-                return checkKeyword(2, 2, "is", TOKEN_THIS);
-            case 'r':
-                return checkKeyword(2, 2, "ue", TOKEN_TRUE);
-            }
-        }
-        break;
-    case 'v':
-        return checkKeyword(1, 2, "ar", TOKEN_VAR);
-    case 'w':
-        return checkKeyword(1, 4, "hile", TOKEN_WHILE);
+    int length = (int)(lexer.current - lexer.start);
+    if (length > KEYWORD_MAX_LENGTH)
+        return TOKEN_IDENTIFIER;
+
+    unsigned slot = keywordHash(length, lexer.start[0], lexer.start[length - 1]);
+    if (keywordTable.lengths[slot] != length)
+        return TOKEN_IDENTIFIER;
+
+    uint64_t word = 0;
+    if (lexer.end - lexer.start >= KEYWORD_MAX_LENGTH) {
+        // Load a whole word and keep only the identifier's bytes
+        memcpy(&word, lexer.start, sizeof(word));
+        uint64_t mask = length == KEYWORD_MAX_LENGTH ? ~(uint64_t)0
+                                                     : ~(~(uint64_t)0 KEYWORD_SHIFT(8 * length));
+        word &= mask;
+    } else {
+        // Near the end of the source only `length` bytes may be read
+        memcpy(&word, lexer.start, length);
     }
+    if (word != keywordTable.words[slot])
+        return TOKEN_IDENTIFIER;
 
-    return TOKEN_IDENTIFIER;
+    return keywordTable.types[slot];
 }
 
 /**
@@ -233,8 +529,7 @@ static TokenType identifierType()
  */
 static Token identifier()
 {
-    while (isAlpha(peek()) || isDigit(peek()))
-        advance();
+    skipIdentifierRun();
     return makeToken(identifierType());
 }
 
@@ -249,17 +544,13 @@ static void skipWhitespace()
         case ' ':
         case '\r':
         case '\t':
-            advance();
-            break;
         case '\n':
-            lexer.line++;
-            advance();
+            skipBlankRun();
             break;
         case '/':
             if (peekNext() == '/') {
                 // A comment goes until the end of the line.
-                while (peek() != '\n' && !isAtEnd())
-                    advance();
+                skipToLineEnd();
             } else {
                 return;
             }
@@ -327,3 +618,151 @@ Token scanToken()
 
     return errorToken("Unexpected character.");
 }
+
+// ======================
+// Token Stream
+// ======================
+
+// Initial token capacity per source byte (tokens average ~4-6 bytes)
+#define STREAM_BYTES_PER_TOKEN 4
+
+/**
+ * Resizes a token stream array, exiting if memory runs out.
+ */
+static void* resizeStreamArray(void* pointer, size_t size)
+{
+    void* result = realloc(pointer, size);
+    if (result == NULL) {
+        fprintf(stderr, "[Delirium] Memory allocation failed\n");
+        exit(1);
+    }
+    return result;
+}
+
+/**
+ * Resizes the parallel token arrays of a stream to `capacity` entries.
+ */
+static void reserveTokens(TokenStream* stream, int capacity)
+{
+    stream->types = (uint8_t*)resizeStreamArray(stream->types, (size_t)capacity);
+    stream->offsets = (uint32_t*)resizeStreamArray(stream->offsets, sizeof(uint32_t) * capacity);
+    stream->lengths = (uint32_t*)resizeStreamArray(stream->lengths, sizeof(uint32_t) * capacity);
+    stream->capacity = capacity;
+}
+
+/**
+ * Records the start of every line of the source in `lineStarts`.
+ */
+static void buildLineIndex(TokenStream* stream, char const* source, size_t length)
+{
+    int capacity = 64;
+    stream->lineStarts = (uint32_t*)resizeStreamArray(NULL, sizeof(uint32_t) * capacity);
+    stream->lineStarts[0] = 0;
+    stream->lineCount = 1;
+
+    char const* end = source + length;
+    for (char const* p = source; p < end;) {
+        p = (char const*)memchr(p, '\n', (size_t)(end - p));
+        if (p == NULL)
+            break;
+        p++;
+        if (stream->lineCount == capacity) {
+            capacity *= 2;
+            stream->lineStarts = (uint32_t*)resizeStreamArray(stream->lineStarts,
+                sizeof(uint32_t) * capacity);
+        }
+        stream->lineStarts[stream->lineCount++] = (uint32_t)(p - source);
+    }
+}
+
+/**
+ * Lexes an entire source into a token stream.
+ *
+ * @param stream Stream to fill
+ * @param source Source text
+ * @param length Length of the source in bytes
+ * @return false if the source does not fit 32-bit offsets
+ */
+bool tokenizeSource(TokenStream* stream, char const* source, size_t length)
+{
+    *stream = TokenStream {};
+    initLexer(source, length);
+    if (length >= UINT32_MAX)
+        return false;
+
+    stream->source = source;
+    reserveTokens(stream, (int)(length / STREAM_BYTES_PER_TOKEN) + 16);
+
+    for (;;) {
+        Token token = scanToken();
+        if (stream->count == stream->capacity)
+            reserveTokens(stream, stream->capacity * 2);
+
+        int index = stream->count++;
+        stream->types[index] = (uint8_t)token.type;
+        if (token.type == TOKEN_ERROR) {
+            stream->messages = (char const**)resizeStreamArray(stream->messages,
+                sizeof(char const*) * (stream->messageCount + 1));
+            stream->offsets[index] = (uint32_t)(lexer.current - source);
+            stream->lengths[index] = (uint32_t)stream->messageCount;
+            stream->messages[stream->messageCount++] = token.start;
+        } else {
+            stream->offsets[index] = (uint32_t)(token.start - source);
+            stream->lengths[index] = (uint32_t)token.length;
+        }
+
+        if (token.type == TOKEN_EOF)
+            break;
+    }
+
+    buildLineIndex(stream, source, length);
+    return true;
+}
+
+/**
+ * Rebuilds the Token at `index` of a stream.
+ *
+ * The line is that of the token's last byte, which is what scanToken()
+ * reports for strings spanning several lines.
+ *
+ * @param stream Stream produced by tokenizeSource()
+ * @param index Token to rebuild
+ * @param lineCursor Index of the line of the previously rebuilt token
+ * @return The token
+ */
+Token streamToken(TokenStream const* stream, int index, int* lineCursor)
+{
+    Token token;
+    token.type = (TokenType)stream->types[index];
+    uint32_t end = stream->offsets[index];
+
+    if (token.type == TOKEN_ERROR) {
+        token.start = stream->messages[stream->lengths[index]];
+        token.length = (int)strlen(token.start);
+    } else {
+        token.start = stream->source + stream->offsets[index];
+        token.length = (int)stream->lengths[index];
+        end += stream->lengths[index];
+    }
+
+    // Count every newline before `end`, i.e. every line starting at or before it
+    int line = *lineCursor;
+    while (line + 1 < stream->lineCount && stream->lineStarts[line + 1] <= end)
+        line++;
+    *lineCursor = line;
+    token.line = line + 1;
+    return token;
+}
+
+/**
+ * Releases the arrays of a token stream.
+ */
+void freeTokenStream(TokenStream* stream)
+{
+    free(stream->types);
+    free(stream->offsets);
+    free(stream->lengths);
+    free(stream->lineStarts);
+    free(stream->messages);
+    *stream = TokenStream {};
+}
@@ -3,60 +3,236 @@
 
 #include <cstdlib>  // For exit() and EXIT_* codes
 #include <cstring>  // For string operations
-#include <fstream>  // For file I/O
-#include <ios>      // For std::ios flags
 #include <iostream> // For std::cerr
 
-#include "vm.h" // Delirium Virtual Machine implementation
+#include <fcntl.h>    // For open()
+#include <sys/mman.h> // For mmap()
+#include <sys/stat.h> // For fstat()
+#include <unistd.h>   // For read(), close(), sysconf()
+
+#include "server.h" // For --serve and client mode
+#include "vm.h"     // Delirium Virtual Machine implementation
+#include "watch.h"  // For --watch
 
 /**
- * Reads the contents of a Delirium source file into memory.
+ * Source text of a script, followed by a '\0' sentinel.
  *
- * @param path Path to the .del source file
- * @return Dynamically allocated buffer containing the source code
- * @throws Exits with status 74 (EX_IOERR) on file operations failure
+ * Regular files are mapped straight into memory; pipes, terminals and
+ * /dev/stdin are read into a heap buffer instead.
  */
-static std::string readFile(std::string const& path) // Accept std::string
+typedef struct SourceFile {
+    char* chars;    // Source text, chars[length] == '\0'
+    size_t length;  // Length in bytes, excluding the sentinel
+    size_t mapSize; // Size of the mapping, or 0 if chars is heap memory
+} SourceFile;
+
+/**
+ * Maps a regular file read-only, with a zero byte after its contents.
+ *
+ * An anonymous zero-filled region one byte longer than the file is
+ * reserved first and the file is mapped over its start. The tail of the
+ * file's last page is zero-filled by the kernel, and when the file ends
+ * exactly on a page boundary the sentinel comes from the anonymous page
+ * behind it.
+ *
+ * @return true on success; false leaves `file` untouched
+ */
+static bool mapSource(int fd, size_t size, SourceFile* file)
 {
-    std::ifstream file(path, std::ios::binary);
-    if (!file) {
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t mapSize = (size + 1 + pageSize - 1) & ~(pageSize - 1);
+
+    void* region = mmap(NULL, mapSize, PROT_READ,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+        return false;
+
+    void* mapped = mmap(region, size, PROT_READ,
+        MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        munmap(region, mapSize);
+        return false;
+    }
+
+    file->chars = (char*)region;
+    file->length = size;
+    file->mapSize = mapSize;
+    return true;
+}
+
+/**
+ * Reads a descriptor to end of input into a heap buffer.
+ *
+ * @return true on success; false if read() fails
+ */
+static bool readSource(int fd, SourceFile* file)
+{
+    size_t capacity = 4096;
+    size_t length = 0;
+    char* chars = (char*)malloc(capacity);
+    if (chars == NULL)
+        return false;
+
+    for (;;) {
+        // Keep one byte free for the sentinel
+        if (length + 1 == capacity) {
+            char* grown = (char*)realloc(chars, capacity * 2);
+            if (grown == NULL) {
+                free(chars);
+                return false;
+            }
+            chars = grown;
+            capacity *= 2;
+        }
+
+        ssize_t count = read(fd, chars + length, capacity - 1 - length);
+        if (count < 0) {
+            free(chars);
+            return false;
+        }
+        if (count == 0)
+            break;
+        length += (size_t)count;
+    }
+
+    chars[length] = '\0';
+    file->chars = chars;
+    file->length = length;
+    file->mapSize = 0;
+    return true;
+}
+
+/**
+ * Releases a source loaded by loadSource().
+ */
+static void freeSource(SourceFile* file)
+{
+    if (file->mapSize > 0)
+        munmap(file->chars, file->mapSize);
+    else
+        free(file->chars);
+}
+
+/**
+ * Loads the contents of a Delirium source file into memory.
+ *
+ * @param path Path to the .del source file, or "-" for standard input
+ * @param file Receives the source text with a '\0' sentinel; release it
+ *             with freeSource()
+ * @return false after reporting a file operations failure
+ *
+ * @note With DEBUG_MUTATE_CODE the mutator replaces the script by renaming
+ *       a new file over it, so a live mapping keeps the original text
+ */
+static bool loadSource(std::string const& path, SourceFile* file)
+{
+    bool isStdin = path == "-";
+    int fd = isStdin ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
         std::cerr << "[Delirium] Could not open file: " << path << std::endl;
-        exit(74);
+        return false;
     }
 
-    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    bool loaded = false;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+        loaded = mapSource(fd, (size_t)info.st_size, file);
 
-    if (source.empty()) {
+    if (!loaded)
+        loaded = readSource(fd, file);
+
+    if (!isStdin)
+        close(fd); // A mapping stays valid after its descriptor is closed
+
+    if (!loaded) {
+        std::cerr << "[Delirium] Could not read file: " << path << std::endl;
+        return false;
+    }
+    if (file->length == 0) {
         std::cerr << "[Delirium] Invalid file size for: " << path << std::endl;
-        exit(74);
+        freeSource(file);
+        return false;
     }
 
-    return source;
+    return true;
 }
 
 /**
- * Executes a Delirium source file.
+ * Loads and executes a Delirium source file in the current VM.
  *
- * @param path Path to the .del file to execute
- * @throws Exits with status 65 (EX_DATAERR) for syntax errors,
- *         70 (EX_SOFTWARE) for runtime errors
+ * @param path Path to the .del file to execute, or "-" for standard input
+ * @param source Receives the loaded source, which the compiled functions
+ *               may still point into; release it with freeSource()
+ * @return 0 on success, 64 (EX_USAGE) for a bad file name, 65 (EX_DATAERR)
+ *         for syntax errors, 70 (EX_SOFTWARE) for runtime errors and
+ *         74 (EX_IOERR) for file operations failure; `source` is only
+ *         loaded when the status is not 64 or 74
  */
-static void runFile(std::string const& path)
+static int runSource(std::string const& path, SourceFile* source)
 {
     // Check if file has .del extension
-    if (path.size() < 4 || path.substr(path.size() - 4) != ".del") {
+    if (path != "-" && (path.size() < 4 || path.substr(path.size() - 4) != ".del")) {
         std::cerr << "[Delirium] Error: File must have .del extension\n";
-        exit(64);
+        return 64;
     }
 
-    std::string source = readFile(path);
+    if (!loadSource(path, source))
+        return 74;
+
     std::string modifiablePath = path;
-    InterpretResult result = interpret(source.c_str(), modifiablePath);
+    InterpretResult result = interpret(source->chars, source->length, modifiablePath);
 
     if (result == INTERPRET_COMPILE_ERROR)
-        exit(65);
+        return 65;
     if (result == INTERPRET_RUNTIME_ERROR)
-        exit(70);
+        return 70;
+    return 0;
+}
+
+/**
+ * Executes a Delirium source file in the current VM.
+ *
+ * @param path Path to the .del file to execute, or "-" for standard input
+ * @return Exit status, as for runSource()
+ */
+static int runScript(std::string const& path)
+{
+    SourceFile source;
+    int status = runSource(path, &source);
+    if (status != 64 && status != 74)
+        freeSource(&source);
+    return status;
+}
+
+/**
+ * Runs the fork server: warms up one VM, then forks it for every request.
+ *
+ * @param socketPath Filesystem path of the socket
+ * @param preludePath Script run once before serving (defines functions
+ *                    and imports modules every request can use), or NULL
+ * @return Exit status if the prelude failed or the socket could not be
+ *         set up
+ */
+static int forkServe(char const* socketPath, char const* preludePath)
+{
+    initVM();
+
+    // The prelude's functions live for the whole server; keep its source
+    SourceFile prelude;
+    int status = 0;
+    bool loaded = false;
+    if (preludePath != NULL) {
+        status = runSource(preludePath, &prelude);
+        loaded = status != 64 && status != 74;
+    }
+    if (status == 0)
+        status = serveScripts(socketPath, runScript, SERVE_FORK);
+
+    freeVM();
+    if (loaded)
+        freeSource(&prelude);
+    return status;
 }
 
 /**
@@ -64,6 +240,15 @@ static void runFile(std::string const& path)
  * ============================
  * Usage:
  *   delirium [script.del]
+ *   delirium -                          (read the script from standard input)
+ *   delirium --serve <socket>           (keep a warm interpreter running)
+ *   delirium --fork-serve <socket> [prelude.del]
+ *                                       (fork a warm interpreter per run)
+ *   delirium --client <socket> <script> (run a script on that interpreter)
+ *   delirium --watch <script>           (rerun the script whenever it changes)
+ *
+ * With DELIRIUM_SOCKET set, `delirium script.del` runs the script on the
+ * server listening there, or locally if none is.
  *
  * Exit Codes:
  *   0 - Success
@@ -74,15 +259,38 @@ static void runFile(std::string const& path)
  */
 int main(int argc, char** argv)
 {
-    initVM();
+    if (argc == 3 && strcmp(argv[1], "--serve") == 0)
+        return serveScripts(argv[2], runScript, SERVE_RESET);
 
-    if (argc == 2) {
-        runFile(argv[1]);
-    } else {
+    if ((argc == 3 || argc == 4) && strcmp(argv[1], "--fork-serve") == 0)
+        return forkServe(argv[2], argc == 4 ? argv[3] : NULL);
+
+    if (argc == 3 && strcmp(argv[1], "--watch") == 0)
+        return watchScript(argv[2], runScript);
+
+    if (argc == 4 && strcmp(argv[1], "--client") == 0) {
+        int status = runRemote(argv[2], argc - 3, argv + 3);
+        if (status < 0) {
+            std::cerr << "[Delirium] No server on: " << argv[2] << std::endl;
+            return 74;
+        }
+        return status;
+    }
+
+    if (argc != 2) {
         std::cerr << "Delirium Language Interpreter\nUsage: delirium [script.dlm]\n";
-        exit(64);
+        return 64;
     }
 
+    char const* socketPath = getenv(SERVER_SOCKET_ENV);
+    if (socketPath != NULL && socketPath[0] != '\0') {
+        int status = runRemote(socketPath, argc - 1, argv + 1);
+        if (status >= 0)
+            return status;
+    }
+
+    initVM();
+    int status = runScript(argv[1]);
     freeVM();
-    return 0;
+    return status;
 }
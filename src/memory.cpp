@@ -1,4 +1,6 @@
+#include <cstdio>   // For fprintf
 #include <cstdlib>  // For free/realloc
+#include <cstring>  // For memcpy
 #include <iostream> // For input/output operations
 #include <memory.h> // For memory operations
 
@@ -6,6 +8,163 @@
 #include "object.h" // For object type definitions
 #include "vm.h"     // For VM object list access
 
+// Local heap of this thread, NULL while it allocates from the VM
+thread_local LocalHeap* localHeap = NULL;
+
+/**
+ * Reports an allocation failure and exits.
+ */
+static void outOfMemory()
+{
+    std::cerr << "[Delirium] Memory allocation failed" << std::endl;
+    exit(1); // Hard exit on allocation failure
+}
+
+#ifdef POOL_ALLOCATOR
+
+/**
+ * Records one more live block in a statistics record.
+ */
+static void countAllocation(PoolStats* stats)
+{
+    stats->allocations++;
+    stats->live++;
+    if (stats->live > stats->peak)
+        stats->peak = stats->live;
+}
+
+/**
+ * Records one block returned in a statistics record.
+ */
+static void countFree(PoolStats* stats)
+{
+    stats->frees++;
+    stats->live--;
+}
+
+/**
+ * Maps a request size (1..POOL_MAX_SIZE) to its size class index.
+ */
+static int sizeClass(size_t size)
+{
+    return (int)((size + POOL_GRANULE - 1) / POOL_GRANULE) - 1;
+}
+
+#endif
+
+/**
+ * Initializes the allocator with empty pools.
+ *
+ * @param allocator Allocator to initialize
+ */
+void initAllocator(Allocator* allocator)
+{
+    memset(allocator, 0, sizeof(Allocator));
+}
+
+/**
+ * Releases every slab page.
+ *
+ * @param allocator Allocator to release
+ */
+void freeAllocator(Allocator* allocator)
+{
+    PoolSlab* slab = allocator->slabs;
+    while (slab != NULL) {
+        PoolSlab* next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    initAllocator(allocator);
+}
+
+/**
+ * Prints per-size-class allocation statistics.
+ *
+ * @param allocator Allocator to report on
+ */
+void printAllocatorStats(Allocator* allocator)
+{
+    fprintf(stderr, "%-8s %12s %12s %10s %10s %6s\n",
+        "class", "allocs", "frees", "live", "peak", "slabs");
+    for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+        PoolStats* stats = &allocator->stats[i];
+        if (stats->allocations == 0)
+            continue;
+        fprintf(stderr, "%-8d %12zu %12zu %10zu %10zu %6zu\n",
+            (i + 1) * POOL_GRANULE, stats->allocations, stats->frees,
+            stats->live, stats->peak, stats->slabs);
+    }
+    fprintf(stderr, "%-8s %12zu %12zu %10zu %10zu %6s\n", "large",
+        allocator->large.allocations, allocator->large.frees,
+        allocator->large.live, allocator->large.peak, "-");
+}
+
+#ifdef POOL_ALLOCATOR
+
+/**
+ * Hands out a block of at least `size` bytes.
+ * Small sizes come from the class free list, then from the class's bump
+ * region, then from a fresh slab; large sizes come from malloc().
+ */
+static void* poolAllocate(Allocator* allocator, size_t size)
+{
+    if (size > POOL_MAX_SIZE) {
+        void* block = malloc(size);
+        if (block == NULL)
+            outOfMemory();
+        countAllocation(&allocator->large);
+        return block;
+    }
+
+    int index = sizeClass(size);
+    countAllocation(&allocator->stats[index]);
+
+    PoolBlock* block = allocator->freeLists[index];
+    if (block != NULL) {
+        allocator->freeLists[index] = block->next;
+        return block;
+    }
+
+    size_t blockSize = (size_t)(index + 1) * POOL_GRANULE;
+    if (allocator->bump[index] == NULL
+        || allocator->bump[index] + blockSize > allocator->bumpEnd[index]) {
+        PoolSlab* slab = (PoolSlab*)malloc(POOL_SLAB_SIZE);
+        if (slab == NULL)
+            outOfMemory();
+        slab->next = allocator->slabs;
+        allocator->slabs = slab;
+        allocator->stats[index].slabs++;
+
+        allocator->bump[index] = (uint8_t*)(slab + 1);
+        allocator->bumpEnd[index] = (uint8_t*)slab + POOL_SLAB_SIZE;
+    }
+
+    void* result = allocator->bump[index];
+    allocator->bump[index] += blockSize;
+    return result;
+}
+
+/**
+ * Returns a block of `size` bytes to its pool (or to free()).
+ */
+static void poolFree(Allocator* allocator, void* pointer, size_t size)
+{
+    if (size > POOL_MAX_SIZE) {
+        free(pointer);
+        countFree(&allocator->large);
+        return;
+    }
+
+    int index = sizeClass(size);
+    PoolBlock* block = (PoolBlock*)pointer;
+    block->next = allocator->freeLists[index];
+    allocator->freeLists[index] = block;
+    countFree(&allocator->stats[index]);
+}
+
+#endif
+
 /**
  * Core memory management function that handles all allocations,
  * reallocations, and deallocations in the VM.
@@ -15,11 +174,47 @@
  * @param newSize Desired size (0 for deallocations)
  * @return Pointer to allocated memory, or NULL if freeing
  *
- * @note Uses realloc() for underlying operations
+ * @note With POOL_ALLOCATOR, small blocks come from vm.allocator and
+ *       resizing within one size class is free; otherwise uses realloc()
  * @note Exits program if allocation fails (out of memory)
  */
 void* reallocate(void* pointer, size_t oldSize, size_t newSize)
 {
+#ifdef POOL_ALLOCATOR
+    Allocator* allocator = localHeap != NULL ? &localHeap->allocator : &vm.allocator;
+
+    // Handle deallocations
+    if (newSize == 0) {
+        if (pointer != NULL)
+            poolFree(allocator, pointer, oldSize);
+        return NULL;
+    }
+
+    if (pointer == NULL)
+        return poolAllocate(allocator, newSize);
+
+    // Large blocks keep using realloc, which may grow in place
+    if (oldSize > POOL_MAX_SIZE && newSize > POOL_MAX_SIZE) {
+        void* result = realloc(pointer, newSize);
+        if (result == NULL)
+            outOfMemory();
+        return result;
+    }
+
+    // Same size class: the block already has room
+    if (oldSize <= POOL_MAX_SIZE && newSize <= POOL_MAX_SIZE
+        && sizeClass(oldSize) == sizeClass(newSize)) {
+        return pointer;
+    }
+
+    // Moving between classes (or between pool and system allocator)
+    void* result = poolAllocate(allocator, newSize);
+    memcpy(result, pointer, oldSize < newSize ? oldSize : newSize);
+    poolFree(allocator, pointer, oldSize);
+    return result;
+#else
+    (void)oldSize; // Only the pools need the old size
+
     // Handle deallocations
     if (newSize == 0) {
         free(pointer);
@@ -30,12 +225,11 @@ void* reallocate(void* pointer, size_t oldSize, size_t newSize)
     void* result = realloc(pointer, newSize);
 
     // Out-of-memory handling
-    if (result == NULL) {
-        std::cerr << "[Delirium] Memory allocation failed" << std::endl;
-        exit(1); // Hard exit on allocation failure
-    }
+    if (result == NULL)
+        outOfMemory();
 
     return result;
+#endif
 }
 
 /**
@@ -45,7 +239,7 @@ void* reallocate(void* pointer, size_t oldSize, size_t newSize)
  *
  * @note Handles type-specific cleanup:
  *   - Functions: Frees their bytecode chunks
- *   - Strings: Frees character buffers
+ *   - Strings: Frees header and inline characters in one block
  *   - All objects: Removes from memory
  */
 static void freeObject(Obj* object)
@@ -67,15 +261,144 @@ static void freeObject(Obj* object)
 
     case OBJ_STRING: {
         ObjString* string = (ObjString*)object;
-        // Free string's character buffer (+1 for null terminator)
-        FREE_ARRAY(char, string->chars, string->length + 1);
-        // Free string object itself
-        FREE(ObjString, object);
+        // Characters are inline; free header and buffer together
+        reallocate(object, STRING_SIZE(string->length), 0);
+        break;
+    }
+
+    case OBJ_ROPE:
+        // Children and the flattened string are objects of their own
+        FREE(ObjRope, object);
+        break;
+
+    case OBJ_STRING_BUILDER: {
+        ObjStringBuilder* builder = (ObjStringBuilder*)object;
+        // Release the text buffer, then the builder itself
+        FREE_ARRAY(char, builder->chars, builder->capacity);
+        FREE(ObjStringBuilder, object);
         break;
     }
+
+    case OBJ_MODULE:
+        // The name and top-level function are objects of their own
+        FREE(ObjModule, object);
+        break;
     }
 }
 
+/**
+ * Prepares an empty local heap.
+ *
+ * @param heap Heap to initialize
+ */
+void initLocalHeap(LocalHeap* heap)
+{
+    initAllocator(&heap->allocator);
+    heap->objects = NULL;
+    initInternSet(&heap->strings);
+}
+
+/**
+ * Hands the slabs and free blocks of one allocator to another.
+ *
+ * The bump regions of `from` are dropped; their slabs still belong to
+ * `to` and are released with it.
+ */
+static void mergeAllocator(Allocator* from, Allocator* to)
+{
+    while (from->slabs != NULL) {
+        PoolSlab* slab = from->slabs;
+        from->slabs = slab->next;
+        slab->next = to->slabs;
+        to->slabs = slab;
+    }
+
+    for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+        while (from->freeLists[i] != NULL) {
+            PoolBlock* block = from->freeLists[i];
+            from->freeLists[i] = block->next;
+            block->next = to->freeLists[i];
+            to->freeLists[i] = block;
+        }
+
+        PoolStats* stats = &to->stats[i];
+        PoolStats* added = &from->stats[i];
+        stats->allocations += added->allocations;
+        stats->frees += added->frees;
+        stats->live += added->live;
+        stats->slabs += added->slabs;
+        if (stats->live > stats->peak)
+            stats->peak = stats->live;
+    }
+    to->large.allocations += from->large.allocations;
+    to->large.frees += from->large.frees;
+    to->large.live += from->large.live;
+    if (to->large.live > to->large.peak)
+        to->large.peak = to->large.live;
+    initAllocator(from);
+}
+
+/**
+ * Returns the string vm.strings holds for an interned string.
+ */
+static ObjString* canonicalString(ObjString* string)
+{
+    if (string == NULL || !string->interned)
+        return string;
+    return internSetFind(&vm.strings, string->chars, string->length, string->hash);
+}
+
+/**
+ * Moves a finished local heap into the VM.
+ *
+ * @param heap Heap no thread uses any more; left empty
+ *
+ * @note Functions and modules are the only objects a compile creates
+ *       that refer to strings
+ */
+void mergeLocalHeap(LocalHeap* heap)
+{
+    // From here on the heap's blocks are freed to the VM's pools
+    mergeAllocator(&heap->allocator, &vm.allocator);
+
+    for (Obj* object = heap->objects; object != NULL; object = object->next) {
+        ObjString* string = (ObjString*)object;
+        if (object->type == OBJ_STRING && string->interned && canonicalString(string) == NULL)
+            internSetAdd(&vm.strings, string);
+    }
+
+    for (Obj* object = heap->objects; object != NULL; object = object->next) {
+        if (object->type == OBJ_FUNCTION) {
+            ObjFunction* function = (ObjFunction*)object;
+            function->name = canonicalString(function->name);
+            ValueArray* constants = &function->chunk.constants;
+            for (int i = 0; i < constants->count; i++) {
+                if (IS_STRING(constants->values[i]))
+                    constants->values[i] = OBJ_VAL(canonicalString(AS_STRING(constants->values[i])));
+            }
+        } else if (object->type == OBJ_MODULE) {
+            ObjModule* module = (ObjModule*)object;
+            module->name = canonicalString(module->name);
+        }
+    }
+
+    Obj* object = heap->objects;
+    while (object != NULL) {
+        Obj* next = object->next;
+        ObjString* string = (ObjString*)object;
+        if (object->type == OBJ_STRING && string->interned && canonicalString(string) != string) {
+            freeObject(object); // A copy of a string the VM already had
+        } else {
+            object->next = vm.objects;
+            vm.objects = object;
+        }
+        object = next;
+    }
+
+    freeInternSet(&heap->strings);
+    heap->objects = NULL;
+}
+
 /**
  * Frees all objects in the VM's object pool.
  *
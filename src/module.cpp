@@ -0,0 +1,240 @@
+#include <atomic>        // For the worker queue index
+#include <climits>       // For PATH_MAX
+#include <cstdlib>       // For realpath
+#include <fstream>       // For reading module files
+#include <functional>    // For std::hash and worker tasks
+#include <iterator>      // For istreambuf_iterator
+#include <string_view>   // For hashing file contents
+#include <thread>        // For worker threads
+#include <unordered_map> // For the module cache
+#include <vector>        // For pending and retired entries
+
+#include "module.h" // For module cache interface
+
+// Cached modules by canonical path
+static std::unordered_map<std::string, ModuleSource*> modules;
+
+// Entries replaced after their file changed; still referenced by code
+static std::vector<ModuleSource*> retiredModules;
+
+// Canonical path of the module holding each namespace in the current run
+static std::unordered_map<std::string, std::string> namespaces;
+
+/**
+ * Reads a whole file into a string.
+ *
+ * @return false if the file could not be opened
+ */
+static bool readModuleFile(std::string const& path, std::string* text)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    text->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+/**
+ * Hashes module contents to detect changed files.
+ */
+static uint64_t hashModuleText(std::string const& text)
+{
+    return std::hash<std::string_view> {}(text);
+}
+
+/**
+ * Creates an empty cache entry for a path.
+ */
+static ModuleSource* newModuleSource(std::string const& path)
+{
+    ModuleSource* source = new ModuleSource();
+    source->path = path;
+
+    // Namespace: the file name without its directory and extension
+    size_t slash = path.rfind('/');
+    source->name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+    if (source->name.size() > 4 && source->name.compare(source->name.size() - 4, 4, ".del") == 0)
+        source->name.resize(source->name.size() - 4);
+    return source;
+}
+
+/**
+ * Reads and lexes a module's file into its entry.
+ *
+ * @note Safe to run on a worker thread: it touches only `source` and the
+ *       thread's own lexer
+ */
+static void lexModule(ModuleSource* source)
+{
+    freeTokenStream(&source->tokens);
+    source->lexed = readModuleFile(source->path, &source->text)
+        && tokenizeSource(&source->tokens, source->text.data(), source->text.size());
+    source->hash = hashModuleText(source->text);
+}
+
+/**
+ * Resolves an import path relative to the importing file.
+ *
+ * @param importer Path of the importing file
+ * @param chars Path as written in the import statement
+ * @param length Length of the written path
+ * @return Canonical path when the file exists, the joined path otherwise
+ */
+std::string resolveModulePath(std::string const& importer, char const* chars, int length)
+{
+    std::string joined(chars, length);
+    if (joined.empty() || joined[0] != '/') {
+        size_t slash = importer == "-" ? std::string::npos : importer.rfind('/');
+        if (slash != std::string::npos)
+            joined.insert(0, importer, 0, slash + 1);
+    }
+
+    char resolved[PATH_MAX];
+    if (realpath(joined.c_str(), resolved) != NULL)
+        return resolved;
+    return joined;
+}
+
+/**
+ * Returns the cache entry for a module, reading and lexing it if needed.
+ *
+ * @param path Path returned by resolveModulePath()
+ * @return Entry for the current contents of the file, or NULL if the
+ *         file could not be read
+ */
+ModuleSource* loadModule(std::string const& path)
+{
+    auto found = modules.find(path);
+    if (found != modules.end()) {
+        ModuleSource* source = found->second;
+        if (source->compiling || (source->module == NULL && source->lexed))
+            return source; // Being compiled, or prefetched and ready
+
+        if (source->module == NULL) {
+            // Unreadable before, or failed to compile: try again
+            lexModule(source);
+            return source->lexed ? source : NULL;
+        }
+
+        // Compiled before: reuse it unless the file has changed since
+        std::string text;
+        if (readModuleFile(path, &text) && hashModuleText(text) == source->hash
+            && text == source->text)
+            return source;
+        retiredModules.push_back(source);
+        modules.erase(found);
+    }
+
+    ModuleSource* source = newModuleSource(path);
+    modules[path] = source;
+    lexModule(source);
+    return source->lexed ? source : NULL;
+}
+
+/**
+ * Reads and lexes modules that are not cached yet, in parallel.
+ *
+ * @param paths Paths returned by resolveModulePath()
+ * @param count Number of paths
+ */
+void prefetchModules(std::string const* paths, int count)
+{
+    std::vector<ModuleSource*> pending;
+    for (int i = 0; i < count; i++) {
+        if (modules.count(paths[i]) != 0)
+            continue;
+        ModuleSource* source = newModuleSource(paths[i]);
+        modules[paths[i]] = source;
+        pending.push_back(source);
+    }
+
+    forEachParallel(pending.size(), [&pending](size_t index) {
+        lexModule(pending[index]);
+    });
+}
+
+/**
+ * Runs a task for every index on worker threads.
+ *
+ * Workers pull indices from a shared counter until none are left, so a
+ * slow task does not hold up the others. A single task runs on the
+ * calling thread.
+ *
+ * @param count Number of indices
+ * @param task Called once per index
+ */
+void forEachParallel(size_t count, std::function<void(size_t)> const& task)
+{
+    if (count < 2) {
+        for (size_t index = 0; index < count; index++)
+            task(index);
+        return;
+    }
+
+    size_t workers = std::thread::hardware_concurrency();
+    if (workers == 0 || workers > count)
+        workers = count;
+
+    std::atomic<size_t> next { 0 };
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < workers; i++) {
+        threads.emplace_back([&task, &next, count]() {
+            for (size_t index = next++; index < count; index = next++)
+                task(index);
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+/**
+ * Returns the cache entry for a path without reading anything.
+ *
+ * @param path Path returned by resolveModulePath()
+ * @return The entry, or NULL if the path was never loaded
+ */
+ModuleSource* findModule(std::string const& path)
+{
+    auto found = modules.find(path);
+    return found == modules.end() ? NULL : found->second;
+}
+
+/**
+ * Reserves a module's namespace for the current run.
+ *
+ * @param source Entry of the module being imported
+ * @return NULL if the namespace was free or already belongs to the same
+ *         file, otherwise the path of the file holding it
+ */
+std::string const* claimModuleName(ModuleSource const* source)
+{
+    auto claimed = namespaces.emplace(source->name, source->path);
+    if (claimed.second || claimed.first->second == source->path)
+        return NULL;
+    return &claimed.first->second;
+}
+
+/**
+ * Frees every namespace for the next run.
+ */
+void releaseModuleNames()
+{
+    namespaces.clear();
+}
+
+/**
+ * Releases every cached module source.
+ */
+void freeModules()
+{
+    for (auto& entry : modules)
+        retiredModules.push_back(entry.second);
+    modules.clear();
+    namespaces.clear();
+
+    for (ModuleSource* source : retiredModules) {
+        freeTokenStream(&source->tokens);
+        delete source;
+    }
+    retiredModules.clear();
+}
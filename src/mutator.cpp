@@ -406,13 +406,24 @@ std::string Mutator::printErrorMessage(std::string const& content)
 
 bool Mutator::overwriteFile(std::string const& content)
 {
-    std::ofstream outFile(path, std::ios::out | std::ios::trunc);
+    // Write a fresh file and rename it over the script: the old inode, and
+    // any mapping the interpreter still compiles from, stays intact
+    std::string temp = path + ".tmp";
+    std::ofstream outFile(temp, std::ios::out | std::ios::trunc);
     if (!outFile.is_open())
         return false;
     outFile << content;
     bool success = outFile.good();
     outFile.close();
-    return success;
+    if (!success) {
+        remove(temp.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    return MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(temp.c_str(), path.c_str()) == 0;
+#endif
 }
 
 Mutator::MutationStrategy Mutator::selectRandomStrategy()
@@ -1,10 +1,9 @@
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
-#include <iostream>
 
 #include "memory.h"
 #include "object.h"
-#include "table.h"
 #include "value.h"
 #include "vm.h"
 
@@ -14,6 +13,15 @@
 #define ALLOCATE_OBJ(type, objectType) \
     (type*)allocateObject(sizeof(type), objectType)
 
+// Inserts an object at the head of the VM's object list, or of the
+// thread's local heap while it has one
+static void trackObject(Obj* object)
+{
+    Obj** objects = localHeap != NULL ? &localHeap->objects : &vm.objects;
+    object->next = *objects;
+    *objects = object;
+}
+
 // Allocates a new object and adds it to the VM's object list
 // size: Size in bytes of the object to allocate
 // type: The type tag for the object (ObjType enum)
@@ -23,11 +31,7 @@ static Obj* allocateObject(size_t size, ObjType type)
     // Allocate raw memory for the object
     Obj* object = (Obj*)reallocate(NULL, 0, size);
     object->type = type;
-
-    // Insert the object at the head of the VM's object list
-    object->next = vm.objects;
-    vm.objects = object;
-
+    trackObject(object);
     return object;
 }
 
@@ -35,12 +39,17 @@ static Obj* allocateObject(size_t size, ObjType type)
 // - arity = 0 (no parameters)
 // - name = NULL (anonymous)
 // - empty bytecode chunk
+// - empty source span, marked as compiled
 // Returns: Pointer to new ObjFunction
 ObjFunction* newFunction()
 {
     ObjFunction* function = ALLOCATE_OBJ(ObjFunction, OBJ_FUNCTION);
     function->arity = 0;
     function->name = NULL;
+    function->body.start = NULL;
+    function->body.length = 0;
+    function->body.line = 0;
+    function->compiled = true;
     initChunk(&function->chunk);
     return function;
 }
@@ -55,24 +64,136 @@ ObjNative* newNative(NativeFn function)
     return native;
 }
 
-// Allocates a string object and adds it to the string table
-// chars: The character data (will be owned by the string)
-// length: Length of the string (not including null terminator)
-// hash: Precomputed hash of the string
-// Returns: Pointer to new ObjString
-static ObjString* allocateString(char* chars, int length, uint32_t hash)
+// Creates a module object that has not run yet
+// name: Namespace of the module
+// function: Compiled top-level code
+// Returns: Pointer to new ObjModule
+ObjModule* newModule(ObjString* name, ObjFunction* function)
 {
-    ObjString* string = ALLOCATE_OBJ(ObjString, OBJ_STRING);
-    string->length = length;
-    string->chars = chars;
-    string->hash = hash;
+    ObjModule* module = ALLOCATE_OBJ(ObjModule, OBJ_MODULE);
+    module->name = name;
+    module->function = function;
+    module->executed = false;
+    return module;
+}
 
-    // Add the string to the VM's string interning table
-    tableSet(&vm.strings, string, NIL_VAL);
+// Creates a new empty string builder
+// The buffer is allocated on the first append
+// Returns: Pointer to new ObjStringBuilder
+ObjStringBuilder* newStringBuilder()
+{
+    ObjStringBuilder* builder = ALLOCATE_OBJ(ObjStringBuilder, OBJ_STRING_BUILDER);
+    builder->length = 0;
+    builder->capacity = 0;
+    builder->chars = NULL;
+    return builder;
+}
 
+// Adds a filled-in string to the VM's object list
+// string: String with its characters in place
+// Returns: The same string, now owned by the VM
+ObjString* adoptString(ObjString* string)
+{
+    trackObject((Obj*)string);
     return string;
 }
 
+// Makes a hashed string the canonical copy in the VM's string table
+// (in the local heap's set on a thread with one, until it is merged)
+// string: String with its characters and hash in place
+// Returns: The same string, now interned
+static ObjString* addInterned(ObjString* string)
+{
+    string->interned = true;
+    internSetAdd(localHeap != NULL ? &localHeap->strings : &vm.strings, string);
+    return string;
+}
+
+// Finds the interned string with the given contents
+// A thread with a local heap only reads vm.strings and looks in its own
+// set for the strings it interned itself
+// Returns: The interned string, or NULL if there is none yet
+static ObjString* findInterned(char const* chars, int length, uint32_t hash)
+{
+    ObjString* interned = internSetFind(&vm.strings, chars, length, hash);
+    if (interned == NULL && localHeap != NULL)
+        interned = internSetFind(&localHeap->strings, chars, length, hash);
+    return interned;
+}
+
+#ifdef STRING_HASH_WYHASH
+
+// Constants from the reference wyhash implementation
+#define WY_SECRET0 0xa0761d6478bd642full
+#define WY_SECRET1 0xe7037ed1a0b428dbull
+#define WY_SECRET2 0x8ebc6af09c88c6e3ull
+
+// Multiplies two 64-bit values and folds the 128-bit product
+static inline uint64_t wyMix(uint64_t a, uint64_t b)
+{
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+// Unaligned little-endian loads
+static inline uint64_t wyRead8(char const* p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t wyRead4(char const* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Computes a 32-bit wyhash-style hash for a string
+// Strings up to 16 bytes take two overlapping loads; longer ones are
+// consumed 16 bytes per round
+// key: Pointer to string data
+// length: Length of string in bytes
+// Returns: 32-bit hash value
+static uint32_t hashString(char const* key, int length)
+{
+    uint8_t const* bytes = (uint8_t const*)key;
+    uint64_t seed = wyMix(WY_SECRET0, WY_SECRET1);
+    uint64_t a;
+    uint64_t b;
+
+    if (length <= 16) {
+        if (length >= 4) {
+            int middle = (length >> 3) << 2;
+            a = (wyRead4(key) << 32) | wyRead4(key + middle);
+            b = (wyRead4(key + length - 4) << 32) | wyRead4(key + length - 4 - middle);
+        } else if (length > 0) {
+            a = ((uint64_t)bytes[0] << 16) | ((uint64_t)bytes[length >> 1] << 8)
+                | bytes[length - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        int remaining = length;
+        char const* p = key;
+        while (remaining > 16) {
+            seed = wyMix(wyRead8(p) ^ WY_SECRET1, wyRead8(p + 8) ^ seed);
+            p += 16;
+            remaining -= 16;
+        }
+        a = wyRead8(p + remaining - 16);
+        b = wyRead8(p + remaining - 8);
+    }
+
+    uint64_t hash = wyMix(WY_SECRET1 ^ (uint64_t)length,
+        wyMix(a ^ WY_SECRET1, b ^ seed ^ WY_SECRET2));
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+#else
+
 // Computes a 32-bit FNV-1a hash for a string
 // key: Pointer to string data
 // length: Length of string in bytes
@@ -87,29 +208,82 @@ static uint32_t hashString(char const* key, int length)
     return hash;
 }
 
-// Creates a string object, taking ownership of the provided chars buffer
-// chars: Character buffer to take ownership of (must be heap allocated)
-// length: Length of the string
+#endif
+
+// Allocates a string object with inline room for its characters
+// length: Length of the string (not including null terminator)
+// Returns: Uninterned string; the caller writes its characters
+ObjString* makeString(int length)
+{
+    ObjString* string = (ObjString*)reallocate(NULL, 0, STRING_SIZE(length));
+    string->obj.type = OBJ_STRING;
+    string->obj.next = NULL;
+    string->length = length;
+    string->hash = 0;
+    string->hashed = false;
+    string->interned = false;
+    string->chars[length] = '\0';
+    return string;
+}
+
+// Interns a string built with makeString(), taking ownership of it
+// string: String whose characters have been written
 // Returns: Pointer to new or existing interned string
-ObjString* takeString(char* chars, int length)
+ObjString* takeString(ObjString* string)
 {
     // Compute the string's hash
-    uint32_t hash = hashString(chars, length);
+    uint32_t hash = hashString(string->chars, string->length);
 
     // Check if string already exists in intern table
-    ObjString* interned = tableFindString(
-        &vm.strings,
-        chars,
-        length,
-        hash);
+    ObjString* interned = findInterned(string->chars, string->length, hash);
     if (interned != NULL) {
-        // Free the duplicate buffer
-        FREE_ARRAY(char, chars, length + 1);
+        // Free the duplicate
+        reallocate(string, STRING_SIZE(string->length), 0);
         return interned;
     }
 
-    // Create new string object
-    return allocateString(chars, length, hash);
+    string->hash = hash;
+    string->hashed = true;
+    return addInterned(adoptString(string));
+}
+
+// Returns a string's hash, computing and caching it on first use
+uint32_t stringHash(ObjString* string)
+{
+    if (!string->hashed) {
+        string->hash = hashString(string->chars, string->length);
+        string->hashed = true;
+    }
+    return string->hash;
+}
+
+// Returns the canonical interned string with the same contents
+// A runtime string with no interned equal becomes the canonical copy
+ObjString* internString(ObjString* string)
+{
+    if (string->interned)
+        return string;
+
+    ObjString* interned = findInterned(string->chars, string->length, stringHash(string));
+    if (interned != NULL)
+        return interned;
+
+    return addInterned(string);
+}
+
+// Compares two strings by content
+// Interned strings are unique, so two of them are equal only if identical
+bool stringsEqual(ObjString* a, ObjString* b)
+{
+    if (a == b)
+        return true;
+    if (a->interned && b->interned)
+        return false;
+    if (a->length != b->length)
+        return false;
+    if (stringHash(a) != stringHash(b))
+        return false;
+    return memcmp(a->chars, b->chars, a->length) == 0;
 }
 
 // Creates a string object by copying the provided characters
@@ -122,21 +296,285 @@ ObjString* copyString(char const* chars, int length)
     uint32_t hash = hashString(chars, length);
 
     // Check if string already exists in intern table
-    ObjString* interned = tableFindString(
-        &vm.strings,
-        chars,
-        length,
-        hash);
+    ObjString* interned = findInterned(chars, length, hash);
     if (interned != NULL)
         return interned;
 
-    // Allocate and copy the string data (+1 for null terminator)
-    char* heapChars = ALLOCATE(char, length + 1);
-    memcpy(heapChars, chars, length);
-    heapChars[length] = '\0';
+    // Allocate the string with its characters inline
+    ObjString* string = makeString(length);
+    memcpy(string->chars, chars, length);
+    string->hash = hash;
+    string->hashed = true;
 
     // Create new string object
-    return allocateString(heapChars, length, hash);
+    return addInterned(adoptString(string));
+}
+
+// Returns the length of a string or rope object
+static int objLength(Obj* object)
+{
+    return object->type == OBJ_ROPE ? ((ObjRope*)object)->length
+                                    : ((ObjString*)object)->length;
+}
+
+// Returns the depth of a string (0) or rope object, treating an already
+// flattened rope as a flat string
+static int objDepth(Obj* object)
+{
+    if (object->type != OBJ_ROPE)
+        return 0;
+    ObjRope* rope = (ObjRope*)object;
+    return rope->flat != NULL ? 0 : rope->depth;
+}
+
+// Uses a rope's flattened string in place of the rope when available,
+// so new ropes do not grow deeper over already-copied text
+static Obj* ropeChild(Value value)
+{
+    if (IS_ROPE(value) && AS_ROPE(value)->flat != NULL)
+        return (Obj*)AS_ROPE(value)->flat;
+    return AS_OBJ(value);
+}
+
+// Creates a rope node joining two string-typed objects
+// left/right: ObjString or ObjRope children
+// Returns: Pointer to new ObjRope
+static ObjRope* newRope(Obj* left, Obj* right)
+{
+    ObjRope* rope = ALLOCATE_OBJ(ObjRope, OBJ_ROPE);
+    rope->length = objLength(left) + objLength(right);
+    int leftDepth = objDepth(left);
+    int rightDepth = objDepth(right);
+    rope->depth = (leftDepth > rightDepth ? leftDepth : rightDepth) + 1;
+    rope->left = left;
+    rope->right = right;
+    rope->flat = NULL;
+    return rope;
+}
+
+// Returns the length of a string-typed value without flattening it
+int stringLength(Value value)
+{
+    return objLength(AS_OBJ(value));
+}
+
+// Concatenates two string-typed values
+// Short results are copied immediately (but not interned); longer ones
+// become a rope node that defers the copy until the characters are needed
+Value concatenateStrings(Value a, Value b)
+{
+    int length = stringLength(a) + stringLength(b);
+
+    // Appending nothing leaves the other operand unchanged
+    if (stringLength(b) == 0)
+        return a;
+    if (stringLength(a) == 0)
+        return b;
+
+    if (length >= ROPE_MIN_LENGTH)
+        return OBJ_VAL(newRope(ropeChild(a), ropeChild(b)));
+
+    // Both operands are shorter than the rope threshold, hence flat
+    ObjString* left = AS_STRING(a);
+    ObjString* right = AS_STRING(b);
+    ObjString* result = makeString(length);
+    memcpy(result->chars, left->chars, left->length);
+    memcpy(result->chars + left->length, right->chars, right->length);
+    return OBJ_VAL(adoptString(result));
+}
+
+// Returns true if a part is copied rather than referenced by a rope node
+static bool isShortPart(Value part)
+{
+    return IS_STRING(part) && AS_STRING(part)->length < ROPE_MIN_LENGTH;
+}
+
+// Concatenates several string-typed values
+// Each run of short flat parts becomes one string, sized and copied once;
+// the pieces are then joined left to right, which only builds rope nodes
+// once the accumulated length reaches ROPE_MIN_LENGTH
+Value concatenateParts(Value* parts, int count)
+{
+    Value result = parts[0];
+    int i = 0;
+
+    while (i < count) {
+        if (!isShortPart(parts[i])) {
+            result = i == 0 ? parts[0] : concatenateStrings(result, parts[i]);
+            i++;
+            continue;
+        }
+
+        // Measure the run of short parts
+        int end = i;
+        int length = 0;
+        while (end < count && isShortPart(parts[end])) {
+            length += AS_STRING(parts[end])->length;
+            end++;
+        }
+
+        Value piece = parts[i];
+        if (end - i > 1) {
+            ObjString* run = makeString(length);
+            int offset = 0;
+            for (int j = i; j < end; j++) {
+                ObjString* part = AS_STRING(parts[j]);
+                memcpy(run->chars + offset, part->chars, part->length);
+                offset += part->length;
+            }
+            piece = OBJ_VAL(adoptString(run));
+        }
+
+        result = i == 0 ? piece : concatenateStrings(result, piece);
+        i = end;
+    }
+
+    return result;
+}
+
+// Copies a rope's characters into one runtime string
+// The walk uses an explicit stack of pending subtrees, filled from the
+// right end of the buffer, so it never recurses; depth + 1 entries suffice
+ObjString* flattenRope(ObjRope* rope)
+{
+    if (rope->flat != NULL)
+        return rope->flat;
+
+    ObjString* result = makeString(rope->length);
+    int stackSize = rope->depth + 1;
+    Obj** stack = ALLOCATE(Obj*, stackSize);
+    int top = 0;
+    int end = rope->length;
+
+    stack[top++] = (Obj*)rope;
+    while (top > 0) {
+        Obj* node = stack[--top];
+
+        if (node->type == OBJ_ROPE && ((ObjRope*)node)->flat != NULL)
+            node = (Obj*)((ObjRope*)node)->flat;
+
+        if (node->type == OBJ_STRING) {
+            ObjString* leaf = (ObjString*)node;
+            end -= leaf->length;
+            memcpy(result->chars + end, leaf->chars, leaf->length);
+        } else {
+            // Right part is written first, since we fill from the end
+            ObjRope* inner = (ObjRope*)node;
+            stack[top++] = inner->left;
+            stack[top++] = inner->right;
+        }
+    }
+
+    FREE_ARRAY(Obj*, stack, stackSize);
+    rope->flat = adoptString(result);
+    return rope->flat;
+}
+
+// Makes room for `extra` more bytes in a builder's buffer
+static void builderReserve(ObjStringBuilder* builder, int extra)
+{
+    int needed = builder->length + extra;
+    if (needed <= builder->capacity)
+        return;
+
+    int oldCapacity = builder->capacity;
+    int capacity = GROW_CAPACITY(oldCapacity);
+    while (capacity < needed)
+        capacity = GROW_CAPACITY(capacity);
+    builder->chars = GROW_ARRAY(char, builder->chars, oldCapacity, capacity);
+    builder->capacity = capacity;
+}
+
+// Appends raw bytes to a builder
+static void builderWrite(ObjStringBuilder* builder, char const* chars, int length)
+{
+    builderReserve(builder, length);
+    memcpy(builder->chars + builder->length, chars, length);
+    builder->length += length;
+}
+
+// Appends the printed form of a value to a builder
+// Matches what `print` would write for the same value
+void builderAppend(ObjStringBuilder* builder, Value value)
+{
+    switch (value.type) {
+    case VAL_BOOL:
+        if (AS_BOOL(value))
+            builderWrite(builder, "true", 4);
+        else
+            builderWrite(builder, "false", 5);
+        return;
+    case VAL_NIL:
+        builderWrite(builder, "nil", 3);
+        return;
+    case VAL_NUMBER: {
+        builderReserve(builder, NUMBER_BUFFER_SIZE);
+        builder->length += formatNumber(builder->chars + builder->length, AS_NUMBER(value));
+        return;
+    }
+    case VAL_OBJ:
+        break;
+    }
+
+    switch (OBJ_TYPE(value)) {
+    case OBJ_STRING: {
+        ObjString* string = AS_STRING(value);
+        builderWrite(builder, string->chars, string->length);
+        break;
+    }
+    case OBJ_ROPE: {
+        ObjString* string = flattenRope(AS_ROPE(value));
+        builderWrite(builder, string->chars, string->length);
+        break;
+    }
+    case OBJ_STRING_BUILDER: {
+        // Reserve before reading: appending a builder to itself moves
+        // the buffer being copied from
+        ObjStringBuilder* other = AS_STRING_BUILDER(value);
+        builderReserve(builder, other->length);
+        memcpy(builder->chars + builder->length, other->chars, other->length);
+        builder->length += other->length;
+        break;
+    }
+    case OBJ_FUNCTION: {
+        ObjFunction* function = AS_FUNCTION(value);
+        if (function->name == NULL) {
+            builderWrite(builder, "<script>", 8);
+        } else {
+            builderWrite(builder, "<fn ", 4);
+            builderWrite(builder, function->name->chars, function->name->length);
+            builderWrite(builder, ">", 1);
+        }
+        break;
+    }
+    case OBJ_NATIVE:
+        builderWrite(builder, "<native fn>", 11);
+        break;
+    case OBJ_MODULE: {
+        ObjModule* module = AS_MODULE(value);
+        builderWrite(builder, "<module ", 8);
+        builderWrite(builder, module->name->chars, module->name->length);
+        builderWrite(builder, ">", 1);
+        break;
+    }
+    }
+}
+
+// Copies a builder's contents into a new runtime string
+ObjString* builderToString(ObjStringBuilder* builder)
+{
+    ObjString* string = makeString(builder->length);
+    if (builder->length > 0)
+        memcpy(string->chars, builder->chars, builder->length);
+    return adoptString(string);
+}
+
+// Returns the flat string for a string or rope value
+ObjString* flatString(Value value)
+{
+    if (IS_ROPE(value))
+        return flattenRope(AS_ROPE(value));
+    return AS_STRING(value);
 }
 
 // Prints a function object's representation
@@ -144,10 +582,10 @@ ObjString* copyString(char const* chars, int length)
 static void printFunction(ObjFunction* function)
 {
     if (function->name == NULL) {
-        printf("<script>"); // Anonymous function
+        outputString(&vm.output, "<script>"); // Anonymous function
         return;
     }
-    printf("<fn %s>", function->name->chars); // Named function
+    outputFormat(&vm.output, "<fn %s>", function->name->chars); // Named function
 }
 
 // Prints any object's string representation
@@ -159,10 +597,23 @@ void printObject(Value value)
         printFunction(AS_FUNCTION(value));
         break;
     case OBJ_NATIVE:
-        printf("<native fn>"); // Native function
+        outputString(&vm.output, "<native fn>"); // Native function
         break;
     case OBJ_STRING:
-        std::cout << AS_CSTRING(value); // String object
+        outputWrite(&vm.output, AS_CSTRING(value), AS_STRING(value)->length); // String object
+        break;
+    case OBJ_ROPE: {
+        ObjString* flat = flattenRope(AS_ROPE(value)); // Flattened on first print
+        outputWrite(&vm.output, flat->chars, flat->length);
+        break;
+    }
+    case OBJ_STRING_BUILDER: {
+        ObjStringBuilder* builder = AS_STRING_BUILDER(value);
+        outputWrite(&vm.output, builder->chars, builder->length); // Current contents
+        break;
+    }
+    case OBJ_MODULE:
+        outputFormat(&vm.output, "<module %s>", AS_MODULE(value)->name->chars); // Imported file
         break;
     }
 }
\ No newline at end of file
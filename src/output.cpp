@@ -0,0 +1,152 @@
+#include <cerrno>   // For EINTR
+#include <cstdarg>  // For va_list
+#include <cstdio>   // For vsnprintf
+#include <cstdlib>  // For malloc/free
+#include <cstring>  // For memcpy/memchr
+#include <unistd.h> // For write/isatty
+
+#include "output.h" // For output buffer interface
+
+/**
+ * Initializes an output buffer for a file descriptor.
+ *
+ * @param output Buffer to prepare
+ * @param fd Descriptor to write to
+ */
+void initOutput(Output* output, int fd)
+{
+    output->fd = fd;
+    output->mode = isatty(fd) ? OUTPUT_LINE : OUTPUT_FULL;
+    output->length = 0;
+}
+
+/**
+ * Changes the flush policy, flushing pending output first.
+ */
+void setOutputMode(Output* output, OutputMode mode)
+{
+    flushOutput(output);
+    output->mode = mode;
+}
+
+/**
+ * Writes bytes straight to the descriptor, retrying partial writes.
+ *
+ * @return false if the descriptor refused the data
+ */
+static bool writeAll(int fd, char const* chars, size_t length)
+{
+    while (length > 0) {
+        ssize_t written = write(fd, chars, length);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        chars += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+/**
+ * Writes all pending output to the file descriptor.
+ */
+void flushOutput(Output* output)
+{
+    if (output->length == 0)
+        return;
+    writeAll(output->fd, output->buffer, output->length);
+    output->length = 0;
+}
+
+/**
+ * Appends bytes to an output buffer.
+ *
+ * @param output Buffer to append to
+ * @param chars Bytes to write
+ * @param length Number of bytes
+ *
+ * @note Writes larger than the buffer bypass it
+ */
+void outputWrite(Output* output, char const* chars, size_t length)
+{
+    if (length > OUTPUT_BUFFER_SIZE - output->length) {
+        flushOutput(output);
+        if (length > OUTPUT_BUFFER_SIZE) {
+            writeAll(output->fd, chars, length);
+            return;
+        }
+    }
+
+    memcpy(output->buffer + output->length, chars, length);
+    output->length += length;
+
+    if (output->mode == OUTPUT_UNBUFFERED
+        || (output->mode == OUTPUT_LINE && memchr(chars, '\n', length) != NULL))
+        flushOutput(output);
+}
+
+/**
+ * Appends a null-terminated string to an output buffer.
+ */
+void outputString(Output* output, char const* string)
+{
+    outputWrite(output, string, strlen(string));
+}
+
+/**
+ * Appends printf-style formatted text to an output buffer.
+ *
+ * The text is formatted in place when it fits the free space; otherwise
+ * the buffer is flushed and, for very long text, a temporary is used.
+ *
+ * @param output Buffer to append to
+ * @param format printf-style format string
+ */
+void outputFormat(Output* output, char const* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    va_list retry;
+    va_copy(retry, args);
+
+    size_t space = OUTPUT_BUFFER_SIZE - output->length;
+    int length = vsnprintf(output->buffer + output->length, space, format, args);
+    va_end(args);
+
+    if (length < 0) {
+        va_end(retry);
+        return;
+    }
+
+    if ((size_t)length < space) {
+        // Formatted in place; account for it like any other write
+        char const* text = output->buffer + output->length;
+        output->length += (size_t)length;
+        if (output->mode == OUTPUT_UNBUFFERED
+            || (output->mode == OUTPUT_LINE && memchr(text, '\n', (size_t)length) != NULL))
+            flushOutput(output);
+    } else {
+        char* text = (char*)malloc((size_t)length + 1);
+        if (text != NULL) {
+            vsnprintf(text, (size_t)length + 1, format, retry);
+            outputWrite(output, text, (size_t)length);
+            free(text);
+        }
+    }
+    va_end(retry);
+}
+
+/**
+ * Ends a line, flushing it when the buffer is line-buffered.
+ */
+void outputNewline(Output* output)
+{
+    if (output->length == OUTPUT_BUFFER_SIZE)
+        flushOutput(output);
+    output->buffer[output->length++] = '\n';
+
+    if (output->mode != OUTPUT_FULL)
+        flushOutput(output);
+}
@@ -0,0 +1,432 @@
+#include <cerrno>   // For errno
+#include <chrono>   // For request latency
+#include <csignal>  // For ignoring SIGPIPE and SIGCHLD
+#include <cstdint>  // For uint32_t
+#include <cstdio>   // For fflush, snprintf
+#include <cstring>  // For strlen, memcpy
+#include <fstream>  // For reading /proc/self/smaps_rollup
+#include <iostream> // For status messages
+#include <vector>   // For request arguments
+
+#include <fcntl.h>        // For open()
+#include <sys/resource.h> // For getrusage()
+#include <sys/socket.h>   // For socket(), sendmsg(), recvmsg()
+#include <sys/un.h>       // For sockaddr_un
+#include <unistd.h>       // For dup2(), chdir(), getcwd(), fork()
+
+#include "server.h" // For server interface
+#include "vm.h"     // For the VM and its output buffer
+
+// Descriptors passed with each request: stdin, stdout and stderr
+#define REQUEST_FDS 3
+
+// Largest accepted request payload (working directory and arguments)
+#define REQUEST_MAX (64 * 1024)
+
+/**
+ * Fills in a socket address, rejecting paths that do not fit.
+ */
+static bool socketAddress(char const* path, struct sockaddr_un* address)
+{
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address->sun_path)) {
+        std::cerr << "[Delirium] Socket path is too long: " << path << std::endl;
+        return false;
+    }
+    strcpy(address->sun_path, path);
+    return true;
+}
+
+/**
+ * Writes a whole buffer to a descriptor.
+ */
+static bool writeFully(int fd, void const* data, size_t length)
+{
+    char const* bytes = (char const*)data;
+    while (length > 0) {
+        ssize_t written = write(fd, bytes, length);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        bytes += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+/**
+ * Reads exactly `length` bytes from a descriptor.
+ */
+static bool readFully(int fd, void* data, size_t length)
+{
+    char* bytes = (char*)data;
+    while (length > 0) {
+        ssize_t count = read(fd, bytes, length);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        bytes += count;
+        length -= (size_t)count;
+    }
+    return true;
+}
+
+/**
+ * Receives a request: the payload length with the client's descriptors
+ * attached, then the payload of NUL-terminated strings (working directory
+ * first, then the arguments).
+ *
+ * @param client Connected socket
+ * @param fds Receives the client's stdin, stdout and stderr
+ * @param strings Receives the payload strings
+ * @return false on a malformed request; no descriptors are left open
+ */
+static bool receiveRequest(int client, int fds[REQUEST_FDS], std::vector<std::string>* strings)
+{
+    uint32_t length = 0;
+    struct iovec part = { &length, sizeof(length) };
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int) * REQUEST_FDS)];
+    } control;
+
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &part;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    ssize_t received;
+    do {
+        received = recvmsg(client, &message, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+
+    struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+    bool hasFds = header != NULL && header->cmsg_level == SOL_SOCKET
+        && header->cmsg_type == SCM_RIGHTS
+        && header->cmsg_len == CMSG_LEN(sizeof(int) * REQUEST_FDS);
+    if (hasFds)
+        memcpy(fds, CMSG_DATA(header), sizeof(int) * REQUEST_FDS);
+
+    std::string payload(length <= REQUEST_MAX ? length : 0, '\0');
+    if (!hasFds || received != (ssize_t)sizeof(length) || length > REQUEST_MAX
+        || !readFully(client, payload.data(), payload.size())) {
+        if (hasFds) {
+            for (int i = 0; i < REQUEST_FDS; i++)
+                close(fds[i]);
+        }
+        return false;
+    }
+
+    for (size_t start = 0; start < payload.size();) {
+        size_t end = payload.find('\0', start);
+        if (end == std::string::npos)
+            end = payload.size();
+        strings->push_back(payload.substr(start, end - start));
+        start = end + 1;
+    }
+    return true;
+}
+
+/**
+ * Runs the script named by a request in the client's working directory.
+ *
+ * @param strings Request payload: working directory, then the arguments
+ * @param run Script runner
+ * @param fresh Whether to run in a newly initialized VM
+ * @return Exit status for the client
+ */
+static int runRequest(std::vector<std::string> const& strings, ScriptRunner run, bool fresh)
+{
+    if (strings.size() != 2) {
+        std::cerr << "Delirium Language Interpreter\nUsage: delirium [script.del]\n";
+        return 64;
+    }
+    if (chdir(strings[0].c_str()) != 0) {
+        std::cerr << "[Delirium] Could not enter directory: " << strings[0] << std::endl;
+        return 74;
+    }
+
+    if (!fresh)
+        return run(strings[1]);
+    initVM();
+    int status = run(strings[1]);
+    freeVM(); // Flushes the script's output to the client
+    return status;
+}
+
+/**
+ * Points descriptors 0-2 at the client's and closes the received copies.
+ */
+static void redirectToClient(int const fds[REQUEST_FDS])
+{
+    fflush(stdout);
+    fflush(stderr);
+    for (int i = 0; i < REQUEST_FDS; i++) {
+        dup2(fds[i], i);
+        close(fds[i]);
+    }
+}
+
+/**
+ * Runs one request with the client's descriptors and working directory.
+ *
+ * @param client Connected socket
+ * @param run Script runner
+ * @param saved Server's own stdin, stdout and stderr
+ * @param home Server's working directory
+ */
+static void handleRequest(int client, ScriptRunner run, int const saved[REQUEST_FDS], int home)
+{
+    int fds[REQUEST_FDS];
+    std::vector<std::string> strings;
+    if (!receiveRequest(client, fds, &strings))
+        return;
+
+    redirectToClient(fds);
+    int status = runRequest(strings, run, true);
+
+    std::cout.flush();
+    fflush(stdout);
+    fflush(stderr);
+    for (int i = 0; i < REQUEST_FDS; i++)
+        dup2(saved[i], i);
+    if (fchdir(home) != 0)
+        std::cerr << "[Delirium] Could not return to the server directory" << std::endl;
+
+    int32_t reply = status;
+    writeFully(client, &reply, sizeof(reply));
+}
+
+/**
+ * Reads how much private memory the process has dirtied, in kilobytes.
+ *
+ * Right after fork() every page is shared with the parent; a page moves
+ * to Private_Dirty when the child writes to it (or allocates it fresh).
+ *
+ * @return Kilobytes, or -1 if /proc/self/smaps_rollup is unavailable
+ */
+static long privateDirtyKB()
+{
+    std::ifstream rollup("/proc/self/smaps_rollup");
+    std::string field;
+    long kilobytes;
+    while (rollup >> field) {
+        if (field == "Private_Dirty:" && rollup >> kilobytes)
+            return kilobytes;
+        rollup.ignore(256, '\n');
+    }
+    return -1;
+}
+
+/**
+ * Returns the number of minor page faults (including copy-on-write
+ * faults) taken by the process so far.
+ */
+static long minorFaults()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+/**
+ * Runs one request in a forked child of the warm server process.
+ *
+ * The child inherits the initialized VM, natives and prelude
+ * copy-on-write, runs the script, replies to the client and exits
+ * without tearing the VM down. It then logs the request's latency
+ * (from accept to reply) and the pages it had to copy.
+ *
+ * @param listener Listening socket (closed in the child)
+ * @param client Connected socket
+ * @param run Script runner
+ * @param log Server's own stderr
+ * @param accepted When the connection was accepted
+ */
+static void forkRequest(int listener, int client, ScriptRunner run, int log,
+    std::chrono::steady_clock::time_point accepted)
+{
+    static long requests = 0;
+    requests++;
+
+    flushOutput(&vm.output); // Nothing buffered may be written twice
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid < 0)
+        std::cerr << "[Delirium] Could not fork a request" << std::endl;
+    if (pid != 0)
+        return; // The client sees a closed connection if fork() failed
+
+    close(listener);
+    long dirtyBefore = privateDirtyKB();
+    long faultsBefore = minorFaults();
+
+    int fds[REQUEST_FDS];
+    std::vector<std::string> strings;
+    if (!receiveRequest(client, fds, &strings))
+        _exit(0);
+
+    redirectToClient(fds);
+    initOutput(&vm.output, STDOUT_FILENO); // Pick the client's buffering mode
+    int status = runRequest(strings, run, false);
+    flushOutput(&vm.output);
+    std::cout.flush();
+    fflush(stdout);
+    fflush(stderr);
+
+    int32_t reply = status;
+    writeFully(client, &reply, sizeof(reply));
+    double milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - accepted).count();
+
+    long dirtyAfter = privateDirtyKB();
+    long pageKB = sysconf(_SC_PAGESIZE) / 1024;
+    char line[160];
+    int length;
+    if (dirtyBefore >= 0 && dirtyAfter >= 0) {
+        length = snprintf(line, sizeof(line),
+            "[Delirium] Request %ld (pid %d, status %d): %.3f ms, %ld pages copied, %ld minor faults\n",
+            requests, (int)getpid(), status, milliseconds,
+            (dirtyAfter - dirtyBefore) / pageKB, minorFaults() - faultsBefore);
+    } else {
+        length = snprintf(line, sizeof(line),
+            "[Delirium] Request %ld (pid %d, status %d): %.3f ms, %ld minor faults\n",
+            requests, (int)getpid(), status, milliseconds, minorFaults() - faultsBefore);
+    }
+    writeFully(log, line, (size_t)length);
+    _exit(0); // Skip freeVM() and static destructors; the pages die with us
+}
+
+/**
+ * Serves script runs on a Unix domain socket.
+ *
+ * @param socketPath Filesystem path of the socket
+ * @param run Script runner
+ * @param mode How each request gets its VM
+ * @return Exit status if the socket could not be set up
+ */
+int serveScripts(char const* socketPath, ScriptRunner run, ServeMode mode)
+{
+    struct sockaddr_un address;
+    if (!socketAddress(socketPath, &address))
+        return 64;
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(socketPath); // A stale socket from an earlier server
+    if (listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0
+        || listen(listener, SOMAXCONN) != 0) {
+        std::cerr << "[Delirium] Could not listen on: " << socketPath << std::endl;
+        return 74;
+    }
+
+    // A client that disconnects mid-run must not take the server down
+    signal(SIGPIPE, SIG_IGN);
+
+    // Forked children answer their clients themselves; nothing to collect
+    if (mode == SERVE_FORK)
+        signal(SIGCHLD, SIG_IGN);
+
+    int saved[REQUEST_FDS];
+    for (int i = 0; i < REQUEST_FDS; i++)
+        saved[i] = fcntl(i, F_DUPFD_CLOEXEC, REQUEST_FDS);
+    int home = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    std::cerr << "[Delirium] Serving on " << socketPath
+              << (mode == SERVE_FORK ? " (fork per request)" : "") << std::endl;
+    for (;;) {
+        int client = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+        auto accepted = std::chrono::steady_clock::now();
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            std::cerr << "[Delirium] Could not accept a connection" << std::endl;
+            break;
+        }
+        if (mode == SERVE_FORK)
+            forkRequest(listener, client, run, saved[STDERR_FILENO], accepted);
+        else
+            handleRequest(client, run, saved, home);
+        close(client);
+    }
+
+    close(listener);
+    unlink(socketPath);
+    return 74;
+}
+
+/**
+ * Sends a script run to a server and waits for its exit status.
+ *
+ * @param socketPath Filesystem path of the server's socket
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return Exit status of the run, or -1 if no server accepted the request
+ */
+int runRemote(char const* socketPath, int argc, char** argv)
+{
+    struct sockaddr_un address;
+    if (!socketAddress(socketPath, &address))
+        return -1;
+
+    int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server < 0)
+        return -1;
+    if (connect(server, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(server);
+        return -1;
+    }
+
+    // Payload: working directory, then the arguments, each NUL-terminated
+    std::string payload;
+    std::vector<char> directory(4096);
+    while (getcwd(directory.data(), directory.size()) == NULL && errno == ERANGE)
+        directory.resize(directory.size() * 2);
+    payload.append(directory.data()).push_back('\0');
+    for (int i = 0; i < argc; i++)
+        payload.append(argv[i]).push_back('\0');
+
+    uint32_t length = (uint32_t)payload.size();
+    struct iovec part = { &length, sizeof(length) };
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int) * REQUEST_FDS)];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &part;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int) * REQUEST_FDS);
+    int fds[REQUEST_FDS] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    memcpy(CMSG_DATA(header), fds, sizeof(fds));
+
+    if (sendmsg(server, &message, 0) != (ssize_t)sizeof(length)
+        || !writeFully(server, payload.data(), payload.size())) {
+        close(server);
+        return -1;
+    }
+
+    // The server writes to our descriptors directly; wait for the status
+    int32_t status;
+    bool finished = readFully(server, &status, sizeof(status));
+    close(server);
+    if (!finished) {
+        std::cerr << "[Delirium] Server closed the connection" << std::endl;
+        return 70;
+    }
+    return status;
+}
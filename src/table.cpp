@@ -1,13 +1,75 @@
 #include <cstdlib> // For NULL
-#include <cstring> // For memcmp
+#include <cstring> // For memcmp, memset
+
+#ifdef __SSE2__
+#include <emmintrin.h> // For 16-byte group scans and compares
+#endif
 
 #include "memory.h" // For memory allocation macros
 #include "object.h" // For ObjString definition
-#include "table.h"  // For Table and Entry declarations
+#include "table.h"  // For Table declarations
 #include "value.h"  // For Value type
 
-// Maximum load factor before resizing the table (75%)
-#define TABLE_MAX_LOAD 0.75
+// Control byte values; full slots hold a 7-bit hash fragment (0..127)
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xfe
+
+// Maximum share of slots (live plus tombstones) in use: 7/8
+#define TABLE_MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
+
+// Splits a hash into the group index bits and the 7-bit control fragment
+#define HASH_GROUP(hash) ((hash) >> 7)
+#define HASH_FRAGMENT(hash) ((uint8_t)((hash) & 0x7f))
+
+// ======================
+// Group Scanning
+// ======================
+
+/**
+ * Returns a bit mask of the slots in a group whose control byte equals
+ * `byte` (bit i set for slot i).
+ */
+static inline uint32_t groupMatch(uint8_t const* group, uint8_t byte)
+{
+#ifdef __SSE2__
+    __m128i controls = _mm_loadu_si128((__m128i const*)group);
+    return (uint32_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(controls, _mm_set1_epi8((char)byte)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < TABLE_GROUP_WIDTH; i++) {
+        if (group[i] == byte)
+            mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * Returns a bit mask of the empty or deleted slots in a group.
+ *
+ * @note Both special values have the top bit set and full slots never do
+ */
+static inline uint32_t groupMatchFree(uint8_t const* group)
+{
+#ifdef __SSE2__
+    __m128i controls = _mm_loadu_si128((__m128i const*)group);
+    return (uint32_t)_mm_movemask_epi8(controls);
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < TABLE_GROUP_WIDTH; i++) {
+        if (group[i] & 0x80)
+            mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+/** Returns the index of the lowest set bit of a non-zero mask */
+static inline int lowestBit(uint32_t mask)
+{
+    return __builtin_ctz(mask);
+}
 
 /**
  * Initializes an empty hash table.
@@ -17,8 +79,11 @@
 void initTable(Table* table)
 {
     table->count = 0;      // No entries stored
+    table->tombstones = 0; // No deleted slots
     table->capacity = 0;   // No storage allocated
-    table->entries = NULL; // Entries array pointer
+    table->control = NULL; // Slot arrays
+    table->keys = NULL;
+    table->values = NULL;
 }
 
 /**
@@ -30,49 +95,66 @@ void initTable(Table* table)
  */
 void freeTable(Table* table)
 {
-    // Free the entries array
-    FREE_ARRAY(Entry, table->entries, table->capacity);
+    // Free the slot arrays
+    FREE_ARRAY(uint8_t, table->control, table->capacity);
+    FREE_ARRAY(ObjString*, table->keys, table->capacity);
+    FREE_ARRAY(Value, table->values, table->capacity);
     // Reset to initial empty state
     initTable(table);
 }
 
 /**
- * Finds an entry for the given key in the hash table.
+ * Finds the slot holding the given key.
  *
- * @param entries Pointer to entries array
- * @param capacity Size of the entries array
+ * @param table Table to search (must have storage)
  * @param key String key to search for
- * @return Pointer to the found entry or an empty slot
+ * @return Slot index, or -1 if the key is absent
  *
- * @note Uses linear probing for collision resolution
- * @note Handles tombstone entries during search
+ * @note Probes whole groups, stepping 1, 2, 3... groups ahead
+ *       (triangular probing visits every group of a power-of-two table)
+ * @note Stops at the first group that has an empty slot
  */
-static Entry* findEntry(Entry* entries, int capacity,
-    ObjString* key)
+static int findSlot(Table* table, ObjString* key)
 {
-    // Start at initial bucket position
-    uint32_t index = key->hash % capacity;
-    Entry* tombstone = NULL; // First tombstone encountered
-
-    for (;;) {
-        Entry* entry = &entries[index];
-
-        if (entry->key == NULL) {
-            if (IS_NIL(entry->value)) {
-                // Empty entry (not tombstone)
-                return tombstone != NULL ? tombstone : entry;
-            } else {
-                // Found a tombstone entry
-                if (tombstone == NULL)
-                    tombstone = entry;
-            }
-        } else if (entry->key == key) {
-            // Found exact key match
-            return entry;
+    int groupMask = table->capacity / TABLE_GROUP_WIDTH - 1;
+    uint32_t group = HASH_GROUP(key->hash) & groupMask;
+    uint8_t fragment = HASH_FRAGMENT(key->hash);
+
+    for (int step = 1;; step++) {
+        int base = group * TABLE_GROUP_WIDTH;
+        uint8_t const* controls = table->control + base;
+
+        // Only keys with a matching hash fragment are dereferenced
+        for (uint32_t mask = groupMatch(controls, fragment); mask != 0; mask &= mask - 1) {
+            int slot = base + lowestBit(mask);
+            if (table->keys[slot] == key)
+                return slot;
         }
 
-        // Move to next slot (with wrapping)
-        index = (index + 1) % capacity;
+        if (groupMatch(controls, CTRL_EMPTY) != 0)
+            return -1;
+        group = (group + step) & groupMask;
+    }
+}
+
+/**
+ * Finds the first empty or deleted slot on a key's probe sequence.
+ *
+ * @param table Table to search (must have a free slot)
+ * @param hash Hash of the key to insert
+ * @return Slot index to store the key in
+ */
+static int findFreeSlot(Table* table, uint32_t hash)
+{
+    int groupMask = table->capacity / TABLE_GROUP_WIDTH - 1;
+    uint32_t group = HASH_GROUP(hash) & groupMask;
+
+    for (int step = 1;; step++) {
+        int base = group * TABLE_GROUP_WIDTH;
+        uint32_t mask = groupMatchFree(table->control + base);
+        if (mask != 0)
+            return base + lowestBit(mask);
+        group = (group + step) & groupMask;
     }
 }
 
@@ -90,54 +172,55 @@ bool tableGet(Table* table, ObjString* key, Value* value)
     if (table->count == 0)
         return false;
 
-    // Find the entry for the key
-    Entry* entry = findEntry(table->entries, table->capacity, key);
-    if (entry->key == NULL)
+    // Find the slot for the key
+    int slot = findSlot(table, key);
+    if (slot < 0)
         return false; // Key not found
 
     // Return the found value
-    *value = entry->value;
+    *value = table->values[slot];
     return true;
 }
 
 /**
- * Resizes the hash table to the new capacity.
+ * Rebuilds the table with the given capacity.
  *
  * @param table Table to resize
- * @param capacity New capacity (must be larger than current)
+ * @param capacity New capacity (power of two, at least TABLE_GROUP_WIDTH)
  *
- * @note Rehashes all existing entries
- * @note Ignores tombstones during rehashing
+ * @note Rehashes all live entries and drops tombstones
  */
 static void adjustCapacity(Table* table, int capacity)
 {
-    // Allocate new empty entries array
-    Entry* entries = ALLOCATE(Entry, capacity);
-    for (int i = 0; i < capacity; i++) {
-        entries[i].key = NULL;
-        entries[i].value = NIL_VAL;
-    }
+    // Allocate new slot arrays, all empty
+    uint8_t* control = ALLOCATE(uint8_t, capacity);
+    ObjString** keys = ALLOCATE(ObjString*, capacity);
+    Value* values = ALLOCATE(Value, capacity);
+    memset(control, CTRL_EMPTY, capacity);
 
-    // Rehash existing entries into new array
-    table->count = 0;
+    Table resized;
+    resized.count = table->count;
+    resized.tombstones = 0;
+    resized.capacity = capacity;
+    resized.control = control;
+    resized.keys = keys;
+    resized.values = values;
+
+    // Rehash live entries into the new arrays
     for (int i = 0; i < table->capacity; i++) {
-        Entry* entry = &table->entries[i];
-        if (entry->key == NULL)
+        if (table->control[i] & 0x80)
             continue; // Skip empty slots and tombstones
 
-        // Find position in new array
-        Entry* dest = findEntry(entries, capacity, entry->key);
-        dest->key = entry->key;
-        dest->value = entry->value;
-        table->count++;
+        ObjString* key = table->keys[i];
+        int slot = findFreeSlot(&resized, key->hash);
+        control[slot] = HASH_FRAGMENT(key->hash);
+        keys[slot] = key;
+        values[slot] = table->values[i];
     }
 
-    // Free old entries array
-    FREE_ARRAY(Entry, table->entries, table->capacity);
-
-    // Update table with new storage
-    table->entries = entries;
-    table->capacity = capacity;
+    // Free old slot arrays and adopt the new ones
+    freeTable(table);
+    *table = resized;
 }
 
 /**
@@ -148,28 +231,40 @@ static void adjustCapacity(Table* table, int capacity)
  * @param value Value to associate with key
  * @return true if new key was added, false if existing key was updated
  *
- * @note Automatically grows table if load factor exceeds TABLE_MAX_LOAD
+ * @note Rebuilds the table when live entries plus tombstones would exceed
+ *       7/8 of the slots: at the same size if tombstones make up most of
+ *       the load, otherwise at twice the size
  */
 bool tableSet(Table* table, ObjString* key, Value value)
 {
-    // Grow table if needed
-    if (table->count + 1 > table->capacity * TABLE_MAX_LOAD) {
-        int capacity = GROW_CAPACITY(table->capacity);
-        adjustCapacity(table, capacity);
+    // Replace the value of an existing key
+    if (table->count > 0) {
+        int slot = findSlot(table, key);
+        if (slot >= 0) {
+            table->values[slot] = value;
+            return false;
+        }
     }
 
-    // Find or create entry for the key
-    Entry* entry = findEntry(table->entries, table->capacity, key);
-    bool isNewKey = entry->key == NULL;
+    // Make room for a new key
+    if (table->count + table->tombstones + 1 > TABLE_MAX_LOAD(table->capacity)) {
+        int capacity = table->capacity;
+        if (capacity == 0)
+            capacity = TABLE_GROUP_WIDTH;
+        else if (table->count + 1 > TABLE_MAX_LOAD(capacity) / 2)
+            capacity *= 2;
+        adjustCapacity(table, capacity);
+    }
 
-    // Only increment count if not replacing tombstone
-    if (isNewKey && IS_NIL(entry->value))
-        table->count++;
+    int slot = findFreeSlot(table, key->hash);
+    if (table->control[slot] == CTRL_DELETED)
+        table->tombstones--; // Reusing a tombstone
 
-    // Update the entry
-    entry->key = key;
-    entry->value = value;
-    return isNewKey;
+    table->control[slot] = HASH_FRAGMENT(key->hash);
+    table->keys[slot] = key;
+    table->values[slot] = value;
+    table->count++;
+    return true;
 }
 
 /**
@@ -179,7 +274,9 @@ bool tableSet(Table* table, ObjString* key, Value value)
  * @param key Key to remove
  * @return true if key was found and removed, false otherwise
  *
- * @note Leaves a tombstone entry to maintain probe sequences
+ * @note If the slot's group still has an empty slot, no probe ever moved
+ *       past this group, so the slot can become empty again instead of
+ *       a tombstone
  */
 bool tableDelete(Table* table, ObjString* key)
 {
@@ -187,14 +284,21 @@ bool tableDelete(Table* table, ObjString* key)
     if (table->count == 0)
         return false;
 
-    // Find the entry
-    Entry* entry = findEntry(table->entries, table->capacity, key);
-    if (entry->key == NULL)
+    // Find the slot
+    int slot = findSlot(table, key);
+    if (slot < 0)
         return false; // Key not found
 
-    // Replace with tombstone (key=NULL, value=true)
-    entry->key = NULL;
-    entry->value = BOOL_VAL(true);
+    uint8_t const* group = table->control + (slot & ~(TABLE_GROUP_WIDTH - 1));
+    if (groupMatch(group, CTRL_EMPTY) != 0) {
+        table->control[slot] = CTRL_EMPTY;
+    } else {
+        table->control[slot] = CTRL_DELETED;
+        table->tombstones++;
+    }
+    table->keys[slot] = NULL;
+    table->values[slot] = NIL_VAL;
+    table->count--;
     return true;
 }
 
@@ -208,14 +312,45 @@ bool tableDelete(Table* table, ObjString* key)
  */
 void tableAddAll(Table* from, Table* to)
 {
-    // Process all slots in source table
+    // Process all live slots in source table
     for (int i = 0; i < from->capacity; i++) {
-        Entry* entry = &from->entries[i];
-        // Only copy actual entries (skip empty/tombstones)
-        if (entry->key != NULL) {
-            tableSet(to, entry->key, entry->value);
-        }
+        if (!(from->control[i] & 0x80))
+            tableSet(to, from->keys[i], from->values[i]);
+    }
+}
+
+/**
+ * Compares two byte ranges of the same length.
+ *
+ * Interned strings are mostly short identifiers, where the call into
+ * memcmp costs more than the compare itself. With SSE2 this compares 16
+ * bytes per step, then finishes with 8-byte words and single bytes.
+ *
+ * @return true if the ranges hold the same bytes
+ */
+static inline bool charsEqual(char const* a, char const* b, int length)
+{
+    int i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= length; i += 16) {
+        __m128i x = _mm_loadu_si128((__m128i const*)(a + i));
+        __m128i y = _mm_loadu_si128((__m128i const*)(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff)
+            return false;
     }
+#endif
+    for (; i + 8 <= length; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + i, sizeof(x));
+        memcpy(&y, b + i, sizeof(y));
+        if (x != y)
+            return false;
+    }
+    for (; i < length; i++) {
+        if (a[i] != b[i])
+            return false;
+    }
+    return true;
 }
 
 /**
@@ -236,21 +371,25 @@ ObjString* tableFindString(Table* table, char const* chars,
     if (table->count == 0)
         return NULL;
 
-    // Start at initial bucket position
-    uint32_t index = hash % table->capacity;
-    for (;;) {
-        Entry* entry = &table->entries[index];
-
-        if (entry->key == NULL) {
-            // Stop if we find an empty non-tombstone entry
-            if (IS_NIL(entry->value))
-                return NULL;
-        } else if (entry->key->length == length && entry->key->hash == hash && memcmp(entry->key->chars, chars, length) == 0) {
-            // Found matching string
-            return entry->key;
+    int groupMask = table->capacity / TABLE_GROUP_WIDTH - 1;
+    uint32_t group = HASH_GROUP(hash) & groupMask;
+    uint8_t fragment = HASH_FRAGMENT(hash);
+
+    for (int step = 1;; step++) {
+        int base = group * TABLE_GROUP_WIDTH;
+        uint8_t const* controls = table->control + base;
+
+        for (uint32_t mask = groupMatch(controls, fragment); mask != 0; mask &= mask - 1) {
+            ObjString* key = table->keys[base + lowestBit(mask)];
+            if (key->length == length && key->hash == hash && charsEqual(key->chars, chars, length)) {
+                // Found matching string
+                return key;
+            }
         }
 
-        // Move to next slot (with wrapping)
-        index = (index + 1) % table->capacity;
+        // Stop at the first group with an empty slot
+        if (groupMatch(controls, CTRL_EMPTY) != 0)
+            return NULL;
+        group = (group + step) & groupMask;
     }
-}
\ No newline at end of file
+}
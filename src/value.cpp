@@ -1,10 +1,12 @@
+#include <charconv> // For std::to_chars
+#include <cmath>    // For std::signbit
 #include <cstring>  // For string operations
-#include <iostream> // For output operations
 #include <numbers>  // For number constants
 
 #include "memory.h" // For memory management macros
 #include "object.h" // For object printing
 #include "value.h"  // For Value type definitions
+#include "vm.h"     // For the VM output buffer
 
 /**
  * Initializes an empty ValueArray.
@@ -63,6 +65,41 @@ void freeValueArray(ValueArray* array)
     initValueArray(array);
 }
 
+// Largest integer printed by the integer fast path: every integer up to
+// 2^53 is exact, while %g switches to exponent notation past six digits
+#ifdef NUMBER_FORMAT_GENERAL
+#define NUMBER_INTEGER_LIMIT 999999.0
+#else
+#define NUMBER_INTEGER_LIMIT 9007199254740992.0
+#endif
+
+/**
+ * Writes the printed form of a number.
+ *
+ * @param buffer Destination of at least NUMBER_BUFFER_SIZE bytes
+ * @param number Number to format
+ * @return Number of characters written
+ *
+ * @note Uses std::to_chars, so the output never depends on the locale
+ */
+int formatNumber(char* buffer, double number)
+{
+    char* end = buffer + NUMBER_BUFFER_SIZE;
+
+    // Integer fast path (-0 keeps its sign through the general path)
+    if (number >= -NUMBER_INTEGER_LIMIT && number <= NUMBER_INTEGER_LIMIT) {
+        int64_t integer = (int64_t)number;
+        if ((double)integer == number && (integer != 0 || !std::signbit(number)))
+            return (int)(std::to_chars(buffer, end, integer).ptr - buffer);
+    }
+
+#ifdef NUMBER_FORMAT_GENERAL
+    return (int)(std::to_chars(buffer, end, number, std::chars_format::general, 6).ptr - buffer);
+#else
+    return (int)(std::to_chars(buffer, end, number).ptr - buffer);
+#endif
+}
+
 /**
  * Prints a Value's string representation to stdout.
  *
@@ -71,21 +108,23 @@ void freeValueArray(ValueArray* array)
  * @note Handles all value types:
  *   - Booleans: "true"/"false"
  *   - Nil: "nil"
- *   - Numbers: %g format
+ *   - Numbers: formatNumber()
  *   - Objects: Delegates to printObject()
  */
 void printValue(Value value)
 {
     switch (value.type) {
     case VAL_BOOL:
-        printf(AS_BOOL(value) ? "true" : "false");
+        outputString(&vm.output, AS_BOOL(value) ? "true" : "false");
         break;
     case VAL_NIL:
-        printf("nil");
+        outputWrite(&vm.output, "nil", 3);
         break;
-    case VAL_NUMBER:
-        printf("%g", AS_NUMBER(value));
+    case VAL_NUMBER: {
+        char buffer[NUMBER_BUFFER_SIZE];
+        outputWrite(&vm.output, buffer, formatNumber(buffer, AS_NUMBER(value)));
         break;
+    }
     case VAL_OBJ:
         printObject(value);
         break;
@@ -101,7 +140,7 @@ void printValue(Value value)
  *
  * @note Follows Delirium's equality rules:
  *   - Different types are never equal
- *   - Objects compared by identity
+ *   - Strings and ropes compared by content, other objects by identity
  *   - Numbers compared by numeric value
  *   - Booleans and nil compared normally
  */
@@ -120,7 +159,16 @@ bool valuesEqual(Value a, Value b)
     case VAL_NUMBER:
         return AS_NUMBER(a) == AS_NUMBER(b);
     case VAL_OBJ:
-        return AS_OBJ(a) == AS_OBJ(b); // Pointer comparison
+        if (AS_OBJ(a) == AS_OBJ(b))
+            return true;
+        // Strings compare by content; ropes are flattened only when the
+        // lengths match
+        if (IS_ANY_STRING(a) && IS_ANY_STRING(b)) {
+            if (stringLength(a) != stringLength(b))
+                return false;
+            return stringsEqual(flatString(a), flatString(b));
+        }
+        return false; // Pointer comparison
     default:
         return false; // Unreachable for valid Values
     }
@@ -5,18 +5,24 @@
 #include <stdarg.h> // For variable arguments
 #include <string>   // For string handling
 #include <time.h>   // For clock() function
+#include <unistd.h> // For STDOUT_FILENO
 
 #include "chunk.h"    // For bytecode chunks
+#include "codeheap.h" // For releasing compiled bytecode
 #include "common.h"   // For common definitions
 #include "compiler.h" // For code compilation
 #include "debug.h"    // For debugging utilities
 #include "lexer.h"
 #include "memory.h" // For memory management
+#include "module.h" // For releasing cached module sources
 #include "mutator.h"
 #include "object.h" // For object system
 #include "value.h"  // For value representation
 #include "vm.h"     // For VM definitions
 
+// Source bytes per expected interned string, for pre-sizing vm.strings
+#define SOURCE_BYTES_PER_STRING 32
+
 // Single global VM instance
 VM vm;
 std::string sourcePath;
@@ -33,6 +39,65 @@ static Value clockNative(int argCount, Value* args)
     return NUMBER_VAL((double)clock() / CLOCKS_PER_SEC);
 }
 
+/**
+ * Native builder() function: creates an empty string builder.
+ *
+ * @param argCount Number of arguments (must be 0)
+ * @param args Argument array (unused)
+ * @return New builder object
+ */
+static Value builderNative(int /* argCount */, Value* /* args */)
+{
+    return OBJ_VAL(newStringBuilder());
+}
+
+/**
+ * Native append(b, v) function: appends the printed form of v to b.
+ *
+ * @param argCount Number of arguments (must be 2)
+ * @param args Builder and value to append
+ * @return The builder, so appends can be chained; nil if b is not a builder
+ */
+static Value appendNative(int argCount, Value* args)
+{
+    if (argCount != 2 || !IS_STRING_BUILDER(args[0]))
+        return NIL_VAL;
+    builderAppend(AS_STRING_BUILDER(args[0]), args[1]);
+    return args[0];
+}
+
+/**
+ * Native build(b) function: returns the builder's contents as a string.
+ *
+ * @param argCount Number of arguments (must be 1)
+ * @param args Builder to read
+ * @return New string; nil if the argument is not a builder
+ */
+static Value buildNative(int argCount, Value* args)
+{
+    if (argCount != 1 || !IS_STRING_BUILDER(args[0]))
+        return NIL_VAL;
+    return OBJ_VAL(builderToString(AS_STRING_BUILDER(args[0])));
+}
+
+/**
+ * Native length(v) function: length in bytes of a builder or string.
+ *
+ * @param argCount Number of arguments (must be 1)
+ * @param args Builder, string or rope
+ * @return Length as a number; nil for other values
+ */
+static Value lengthNative(int argCount, Value* args)
+{
+    if (argCount != 1)
+        return NIL_VAL;
+    if (IS_STRING_BUILDER(args[0]))
+        return NUMBER_VAL((double)AS_STRING_BUILDER(args[0])->length);
+    if (IS_ANY_STRING(args[0]))
+        return NUMBER_VAL((double)stringLength(args[0]));
+    return NIL_VAL;
+}
+
 /**
  * Resets the VM's call stack to empty state.
  */
@@ -51,14 +116,19 @@ static void resetStack()
 static void runtimeError(char const* format, ...)
 {
 #ifdef DEBUG_MUTATE_CODE
-    char const* lex = getLexer();
-    Mutator mut = Mutator(lex, sourcePath);
-    mut.mutateCode();
-
-    resetStack();
-    return;
+    if (vm.mutateOnError) {
+        flushOutput(&vm.output); // The mutator prints straight to std::cout
+        char const* lex = getLexer();
+        Mutator mut = Mutator(lex, sourcePath);
+        mut.mutateCode();
+
+        resetStack();
+        return;
+    }
 #endif
 
+    flushOutput(&vm.output); // Keep the script's output ahead of the error
+
     va_list args;
     va_start(args, format);
     vfprintf(stderr, format, args);
@@ -72,7 +142,7 @@ static void runtimeError(char const* format, ...)
         // Calculate instruction offset in chunk
         size_t instruction = frame->ip - function->chunk.code - 1;
         fprintf(stderr, "[line %d] in ",
-            function->chunk.lines[instruction]);
+            getLine(&function->chunk, (int)instruction));
         if (function->name == NULL) {
             fprintf(stderr, "script\n");
         } else {
@@ -98,16 +168,52 @@ static void defineNative(char const* name, NativeFn function)
     pop();
 }
 
+/**
+ * Defines the built-in functions as globals.
+ */
+static void defineNatives()
+{
+    defineNative("clock", clockNative);     // Built-in clock()
+    defineNative("builder", builderNative); // String builder natives
+    defineNative("append", appendNative);
+    defineNative("build", buildNative);
+    defineNative("length", lengthNative);
+}
+
 /**
  * Initializes the virtual machine to empty state.
  */
 void initVM()
 {
     resetStack();
+    initAllocator(&vm.allocator);       // Empty small-object pools
+    initOutput(&vm.output, STDOUT_FILENO); // Buffered stdout
+    vm.mutateOnError = true;            // Failing scripts get mutated
     vm.objects = NULL;                  // Empty object list
-    initTable(&vm.strings);             // Empty string table
+    initInternSet(&vm.strings);         // Empty string intern set
     initTable(&vm.globals);             // Empty global namespace
-    defineNative("clock", clockNative); // Built-in clock()
+    defineNatives();
+}
+
+/**
+ * Clears the globals the last script defined and marks every module as
+ * not yet run.
+ *
+ * The natives are defined again rather than kept, since the script may
+ * have replaced them or stored them under other names.
+ */
+void resetGlobals()
+{
+    resetStack(); // defineNative() keeps its objects in the bottom slots
+    freeTable(&vm.globals);
+    initTable(&vm.globals);
+    defineNatives();
+    releaseModuleNames();
+
+    for (Obj* object = vm.objects; object != NULL; object = object->next) {
+        if (object->type == OBJ_MODULE)
+            ((ObjModule*)object)->executed = false;
+    }
 }
 
 /**
@@ -115,9 +221,17 @@ void initVM()
  */
 void freeVM()
 {
+    flushOutput(&vm.output); // Nothing may be printed after this
     freeTable(&vm.globals); // Free global variables
-    freeTable(&vm.strings); // Free interned strings
+    freeInternSet(&vm.strings); // Free intern set slots
     freeObjects();          // Free all allocated objects
+    freeCodeHeap();         // Free compiled bytecode
+    freeModules();          // Free module sources (functions point into them)
+
+#ifdef DEBUG_MEMORY_STATS
+    printAllocatorStats(&vm.allocator);
+#endif
+    freeAllocator(&vm.allocator); // Release slab pages last
 }
 
 /**
@@ -175,6 +289,14 @@ static bool call(ObjFunction* function, int argCount)
         return false;
     }
 
+#ifdef LAZY_COMPILE
+    // Compile the body of a lazily scanned function on its first call
+    if (!function->compiled && !compileFunction(function)) {
+        runtimeError("Could not compile function '%s'.", function->name->chars);
+        return false;
+    }
+#endif
+
     // Setup new call frame
     CallFrame* frame = &vm.frames[vm.frameCount++];
     frame->function = function;
@@ -223,21 +345,58 @@ static bool isFalsey(Value value)
 }
 
 /**
- * Concatenates two strings from the stack.
+ * Replaces the top `count` stack values with their sum.
+ *
+ * All-string operands are concatenated in one step. Anything else is
+ * added pairwise from the left with OP_ADD semantics, so mixed operands
+ * report the same error OP_ADD would.
+ *
+ * @return false if a runtime error was reported
  */
-static void concatenate()
+static bool concatenateN(int count)
 {
-    ObjString* b = AS_STRING(pop());
-    ObjString* a = AS_STRING(pop());
+    Value* parts = vm.stackTop - count;
 
-    int length = a->length + b->length;
-    char* chars = ALLOCATE(char, length + 1);
-    memcpy(chars, a->chars, a->length);
-    memcpy(chars + a->length, b->chars, b->length);
-    chars[length] = '\0';
+    bool allStrings = true;
+    for (int i = 0; i < count; i++) {
+        if (!IS_ANY_STRING(parts[i])) {
+            allStrings = false;
+            break;
+        }
+    }
+
+    Value result;
+    if (allStrings) {
+        result = concatenateParts(parts, count);
+    } else {
+        result = parts[0];
+        for (int i = 1; i < count; i++) {
+            if (IS_ANY_STRING(result) && IS_ANY_STRING(parts[i])) {
+                result = concatenateStrings(result, parts[i]);
+            } else if (IS_NUMBER(result) && IS_NUMBER(parts[i])) {
+                result = NUMBER_VAL(AS_NUMBER(result) + AS_NUMBER(parts[i]));
+            } else {
+                runtimeError("Operands must be two numbers or two strings.");
+                return false;
+            }
+        }
+    }
+
+    vm.stackTop -= count;
+    push(result);
+    return true;
+}
 
-    ObjString* result = takeString(chars, length);
-    push(OBJ_VAL(result));
+/**
+ * Concatenates two strings from the stack.
+ *
+ * @note Long results are ropes; see concatenateStrings()
+ */
+static void concatenate()
+{
+    Value b = pop();
+    Value a = pop();
+    push(concatenateStrings(a, b));
 }
 
 /**
@@ -256,11 +415,21 @@ static InterpretResult run()
     (frame->ip += 2, \
         (uint16_t)((frame->ip[-2] << 8) | frame->ip[-1]))
 
+#define READ_LONG()                                      \
+    (frame->ip += 3,                                     \
+        (uint32_t)((frame->ip[-3] << 16) | (frame->ip[-2] << 8) \
+            | frame->ip[-1]))
+
 #define READ_CONSTANT() \
     (frame->function->chunk.constants.values[READ_BYTE()])
 
+#define READ_CONSTANT_LONG() \
+    (frame->function->chunk.constants.values[READ_LONG()])
+
 #define READ_STRING() AS_STRING(READ_CONSTANT())
 
+#define READ_STRING_LONG() AS_STRING(READ_CONSTANT_LONG())
+
 #define BINARY_OP(valueType, op)                          \
     do {                                                  \
         if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) { \
@@ -274,13 +443,13 @@ static InterpretResult run()
 
     for (;;) {
 #ifdef DEBUG_TRACE_EXECUTION
-        std::cout << "        " << std::endl;
+        outputString(&vm.output, "        ");
         for (Value* slot = vm.stack; slot < vm.stackTop; slot++) {
-            std::cout << "[ ";
+            outputString(&vm.output, "[ ");
             printValue(*slot);
-            std::cout << " ]";
+            outputString(&vm.output, " ]");
         }
-        std::cout << std::endl;
+        outputNewline(&vm.output);
         disassembleInstruction(&frame->function->chunk,
             (int)(frame->ip - frame->function->chunk.code));
 #endif
@@ -292,6 +461,11 @@ static InterpretResult run()
             push(constant);
             break;
         }
+        case OP_CONSTANT_LONG: {
+            Value constant = READ_CONSTANT_LONG();
+            push(constant);
+            break;
+        }
         case OP_NIL:
             push(NIL_VAL);
             break;
@@ -314,8 +488,9 @@ static InterpretResult run()
             push(frame->slots[slot]);
             break;
         }
-        case OP_GET_GLOBAL: {
-            ObjString* name = READ_STRING();
+        case OP_GET_GLOBAL:
+        case OP_GET_GLOBAL_LONG: {
+            ObjString* name = instruction == OP_GET_GLOBAL ? READ_STRING() : READ_STRING_LONG();
             Value value;
             if (!tableGet(&vm.globals, name, &value)) {
                 runtimeError("Undefined variable '%s'.", name->chars);
@@ -324,14 +499,16 @@ static InterpretResult run()
             push(value);
             break;
         }
-        case OP_DEFINE_GLOBAL: {
-            ObjString* name = READ_STRING();
+        case OP_DEFINE_GLOBAL:
+        case OP_DEFINE_GLOBAL_LONG: {
+            ObjString* name = instruction == OP_DEFINE_GLOBAL ? READ_STRING() : READ_STRING_LONG();
             tableSet(&vm.globals, name, peek(0));
             pop();
             break;
         }
-        case OP_SET_GLOBAL: {
-            ObjString* name = READ_STRING();
+        case OP_SET_GLOBAL:
+        case OP_SET_GLOBAL_LONG: {
+            ObjString* name = instruction == OP_SET_GLOBAL ? READ_STRING() : READ_STRING_LONG();
             if (tableSet(&vm.globals, name, peek(0))) {
                 tableDelete(&vm.globals, name);
                 runtimeError("Undefined variable '%s'.", name->chars);
@@ -352,7 +529,7 @@ static InterpretResult run()
             BINARY_OP(BOOL_VAL, <);
             break;
         case OP_ADD: {
-            if (IS_STRING(peek(0)) && IS_STRING(peek(1))) {
+            if (IS_ANY_STRING(peek(0)) && IS_ANY_STRING(peek(1))) {
                 concatenate();
             } else if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) {
                 // Approach 1
@@ -368,6 +545,12 @@ static InterpretResult run()
             }
             break;
         }
+        case OP_CONCAT_N: {
+            int count = READ_BYTE();
+            if (!concatenateN(count))
+                return INTERPRET_RUNTIME_ERROR;
+            break;
+        }
         case OP_SUBTRACT:
             BINARY_OP(NUMBER_VAL, -);
             break;
@@ -389,7 +572,7 @@ static InterpretResult run()
             break;
         case OP_PRINTLN:
             printValue(pop());
-            std::cout << std::endl;
+            outputNewline(&vm.output);
             break;
         case OP_PRINT:
             printValue(pop());
@@ -410,6 +593,67 @@ static InterpretResult run()
             frame->ip -= offset;
             break;
         }
+        case OP_FOR_STEP: {
+            uint8_t slot = READ_BYTE();
+            Value step = READ_CONSTANT();
+            uint8_t mode = READ_BYTE();
+            uint8_t limitIndex = READ_BYTE();
+            uint16_t offset = READ_SHORT();
+
+            // Increment: counter = counter + step
+            Value* counter = &frame->slots[slot];
+            if (!IS_NUMBER(*counter)) {
+                runtimeError("Operands must be two numbers or two strings.");
+                return INTERPRET_RUNTIME_ERROR;
+            }
+            double next = AS_NUMBER(*counter) + AS_NUMBER(step);
+            *counter = NUMBER_VAL(next);
+
+            // Condition: counter <cmp> limit
+            Value limit;
+            switch (FOR_STEP_LIMIT(mode)) {
+            case FOR_LIMIT_LOCAL:
+                limit = frame->slots[limitIndex];
+                break;
+            case FOR_LIMIT_CONSTANT:
+                limit = frame->function->chunk.constants.values[limitIndex];
+                break;
+            case FOR_LIMIT_GLOBAL: {
+                ObjString* name = AS_STRING(frame->function->chunk.constants.values[limitIndex]);
+                if (!tableGet(&vm.globals, name, &limit)) {
+                    runtimeError("Undefined variable '%s'.", name->chars);
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+                break;
+            }
+            }
+            if (!IS_NUMBER(limit)) {
+                runtimeError("Operands must be numbers.");
+                return INTERPRET_RUNTIME_ERROR;
+            }
+
+            bool loop;
+            switch (FOR_STEP_COMPARE(mode)) {
+            case FOR_CMP_LESS:
+                loop = next < AS_NUMBER(limit);
+                break;
+            case FOR_CMP_GREATER:
+                loop = next > AS_NUMBER(limit);
+                break;
+            case FOR_CMP_NOT_LESS:
+                loop = !(next < AS_NUMBER(limit));
+                break;
+            case FOR_CMP_NOT_GREATER:
+            default:
+                loop = !(next > AS_NUMBER(limit));
+                break;
+            }
+
+            // Jump back to the body while the condition holds
+            if (loop)
+                frame->ip -= offset;
+            break;
+        }
         case OP_CALL: {
             int argCount = READ_BYTE();
             if (!callValue(peek(argCount), argCount)) {
@@ -431,13 +675,33 @@ static InterpretResult run()
             frame = &vm.frames[vm.frameCount - 1];
             break;
         }
+        case OP_IMPORT: {
+            ObjModule* module = AS_MODULE(peek(0));
+            if (module->executed) {
+                // Already ran (or is running): the import evaluates to nil
+                vm.stackTop[-1] = NIL_VAL;
+                break;
+            }
+
+            // Run the top-level code like a call with no arguments; its
+            // return value replaces the module on the stack
+            module->executed = true;
+            vm.stackTop[-1] = OBJ_VAL(module->function);
+            if (!call(module->function, 0))
+                return INTERPRET_RUNTIME_ERROR;
+            frame = &vm.frames[vm.frameCount - 1];
+            break;
+        }
         }
     }
 
 #undef READ_BYTE
 #undef READ_SHORT
+#undef READ_LONG
 #undef READ_CONSTANT
+#undef READ_CONSTANT_LONG
 #undef READ_STRING
+#undef READ_STRING_LONG
 #undef BINARY_OP
 }
 
@@ -445,12 +709,21 @@ static InterpretResult run()
  * Interprets Delirium source code.
  *
  * @param source Source code to execute
+ * @param length Length of the source in bytes
+ * @param path Path of the script, for the mutator
  * @return Interpretation result status
  */
-InterpretResult interpret(char const* source, std::string& path)
+InterpretResult interpret(char const* source, size_t length, std::string& path)
 {
     sourcePath = path;
-    ObjFunction* function = compile(source);
+
+    // Size the intern set for the identifiers and literals to come, so
+    // compiling a large script does not rehash it repeatedly. Scripts
+    // average roughly one distinct string per SOURCE_BYTES_PER_STRING bytes.
+    internSetReserve(&vm.strings,
+        vm.strings.count + (int)(length / SOURCE_BYTES_PER_STRING));
+
+    ObjFunction* function = compile(source, length);
     if (function == NULL)
         return INTERPRET_COMPILE_ERROR;
 
@@ -0,0 +1,117 @@
+#include <cerrno>   // For errno
+#include <chrono>   // For run times
+#include <cstdio>   // For snprintf
+#include <cstring>  // For strlen, strcmp
+#include <iostream> // For status messages
+
+#include <poll.h>        // For poll()
+#include <sys/inotify.h> // For inotify_init1(), inotify_add_watch()
+#include <unistd.h>      // For read(), close()
+
+#include "compiler.h" // For the function cache
+#include "vm.h"       // For the VM
+#include "watch.h"    // For watch mode interface
+
+/**
+ * Checks whether an event names a Delirium source file.
+ */
+static bool isScriptEvent(struct inotify_event const* event)
+{
+    if (event->len == 0)
+        return false;
+    size_t length = strlen(event->name);
+    return length > 4 && strcmp(event->name + length - 4, ".del") == 0;
+}
+
+/**
+ * Blocks until a .del file in the watched directory changes, then waits
+ * for WATCH_SETTLE_MS without further events so that an editor's burst
+ * of writes triggers a single rerun.
+ *
+ * @param fd inotify descriptor
+ * @return false if the descriptor failed
+ */
+static bool waitForChange(int fd)
+{
+    alignas(struct inotify_event) char buffer[4096];
+    bool changed = false;
+
+    for (;;) {
+        if (changed) {
+            struct pollfd ready = { fd, POLLIN, 0 };
+            int count = poll(&ready, 1, WATCH_SETTLE_MS);
+            if (count == 0)
+                return true;
+            if (count < 0 && errno != EINTR)
+                return false;
+        }
+
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        for (char* next = buffer; next < buffer + length;) {
+            struct inotify_event* event = (struct inotify_event*)next;
+            if (isScriptEvent(event))
+                changed = true;
+            next += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+/**
+ * Runs a script and reruns it on every change.
+ *
+ * @param path Script to watch
+ * @param run Script runner
+ * @return Exit status if the script could not be watched
+ */
+int watchScript(char const* path, ScriptRunner run)
+{
+    std::string script = path;
+    if (script == "-") {
+        std::cerr << "[Delirium] Standard input cannot be watched" << std::endl;
+        return 64;
+    }
+
+    // Watch the directory, not the file: editors often save by renaming a
+    // new file over the old one, and imported modules usually live there
+    size_t slash = script.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : script.substr(0, slash + 1);
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << "[Delirium] Could not watch directory: " << directory << std::endl;
+        if (fd >= 0)
+            close(fd);
+        return 74;
+    }
+
+    initVM();
+    vm.mutateOnError = false; // Rewriting the file would trigger another run
+    enableFunctionCache();
+
+    do {
+        auto start = std::chrono::steady_clock::now();
+        int status = run(script);
+        double milliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        flushOutput(&vm.output);
+
+        RecompileStats stats = functionCacheStats();
+        char summary[160];
+        snprintf(summary, sizeof(summary),
+            "[Delirium] %s in %.3f ms (%d of %d functions reused); watching %s",
+            status == 0 ? "Finished" : "Failed", milliseconds, stats.reused,
+            stats.reused + stats.compiled, path);
+        std::cerr << summary << std::endl;
+
+        resetGlobals();
+    } while (waitForChange(fd));
+
+    close(fd);
+    freeVM();
+    return 74;
+}